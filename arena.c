@@ -0,0 +1,69 @@
+/**
+ * @file arena.c
+ * @brief Bump allocator for per-line parse state.
+ *
+ * Everything built while handling one command line (the line itself, its
+ * tokens and the parsed pipeline) is carved out of an arena and released
+ * all at once with `arenaReset()`. Blocks are kept across resets, so a
+ * shell that has seen its longest line once does no further malloc/free.
+ */
+
+ #include "smallsh.h"
+ 
+ #define ARENA_MIN_BLOCK (16 * 1024)
+ #define ARENA_ALIGN 16
+ 
+ struct arenaBlock {
+     struct arenaBlock *next;
+     size_t size;             // Bytes available in data
+     char data[];
+ };
+ 
+ /**
+  * @brief Allocates `size` bytes, aligned to 16, valid until the next `arenaReset()`.
+  *
+  * Moves on to the next retained block, or links in a new one at least
+  * twice the size of the current block, when the current block is full.
+  */
+ void *arenaAlloc(struct arena *arena, size_t size) {
+     size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+ 
+     while (!arena->current || arena->used + size > arena->current->size) {
+         struct arenaBlock *next = arena->current ? arena->current->next : arena->first;
+ 
+         if (!next || next->size < size) {
+             size_t blockSize = arena->current ? arena->current->size * 2 : ARENA_MIN_BLOCK;
+             if (blockSize < size) blockSize = size;
+             struct arenaBlock *block = malloc(sizeof *block + blockSize);
+             block->size = blockSize;
+             block->next = next;
+             if (arena->current) arena->current->next = block;
+             else arena->first = block;
+             next = block;
+         }
+         arena->current = next;
+         arena->used = 0;
+     }
+ 
+     void *p = arena->current->data + arena->used;
+     arena->used += size;
+     return p;
+ }
+ 
+ /**
+  * @brief Copies `len` bytes of `s` into the arena as a NUL-terminated string.
+  */
+ char *arenaStrndup(struct arena *arena, const char *s, size_t len) {
+     char *copy = arenaAlloc(arena, len + 1);
+     memcpy(copy, s, len);
+     copy[len] = '\0';
+     return copy;
+ }
+ 
+ /**
+  * @brief Frees everything allocated since the last reset, in O(1).
+  */
+ void arenaReset(struct arena *arena) {
+     arena->current = arena->first;
+     arena->used = 0;
+ }
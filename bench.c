@@ -0,0 +1,112 @@
+/**
+ * @file bench.c
+ * @brief `bench`: time a command line over many runs inside the shell.
+ *
+ *     bench [-w WARMUP] N command line...
+ *
+ * The rest of the line, pipes and redirections included, runs N times
+ * through `executeCommand()`, the same path as typing it. Each run's wall
+ * time is recorded and the sorted samples give exact percentiles. The
+ * `smallsh-bench` driver (benchdriver.c) reports through the same code.
+ */
+
+ #include "smallsh.h"
+ 
+ /**
+  * @brief Orders doubles for `qsort()`.
+  */
+ static int compareDoubles(const void *a, const void *b) {
+     double x = *(const double *)a, y = *(const double *)b;
+     return (x > y) - (x < y);
+ }
+ 
+ /**
+  * @brief Returns the `p`th percentile (0-100) of sorted samples, nearest rank.
+  */
+ static double percentile(const double *sorted, int count, double p) {
+     int rank = (int)(count * p / 100 + 0.999999);
+     if (rank < 1) rank = 1;
+     return sorted[rank - 1];
+ }
+ 
+ /**
+  * @brief Prints min/p50/p99/max/mean and throughput for `count` samples.
+  *
+  * Sorts `samplesUs` in place.
+  *
+  * @param label What was measured.
+  * @param samplesUs Per-run latencies in microseconds.
+  * @param count Number of samples.
+  * @param totalUs Wall time for all runs, giving the throughput.
+  * @param unit Name of one run in the throughput line ("cmds", "lines", ...).
+  */
+ void benchReport(const char *label, double *samplesUs, int count, double totalUs, const char *unit) {
+     if (count == 0) return;
+     double sum = 0;
+     for (int i = 0; i < count; i++) sum += samplesUs[i];
+     qsort(samplesUs, count, sizeof *samplesUs, compareDoubles);
+ 
+     printf("%s: %d runs in %.3fs, %.1f %s/s\n", label, count, totalUs / 1e6, count / (totalUs / 1e6), unit);
+     printf("  min %.3fms  p50 %.3fms  p99 %.3fms  max %.3fms  mean %.3fms\n",
+            samplesUs[0] / 1e3, percentile(samplesUs, count, 50) / 1e3,
+            percentile(samplesUs, count, 99) / 1e3, samplesUs[count - 1] / 1e3, sum / count / 1e3);
+     flushOutput();
+ }
+ 
+ /**
+  * @brief Built-in `bench [-w WARMUP] N command...`: runs the rest of the line N times.
+  *
+  * @param pipeline The whole line; stage 0 starts with `bench` and its options.
+  * @return Exit status of the last run, or 1 for a usage error.
+  */
+ int benchBuiltin(struct pipeline *pipeline) {
+     char **args = pipeline->stages[0].args;
+     int warmup = 0, i = 1;
+ 
+     if (args[i] && strncmp(args[i], "-w", 2) == 0) {
+         const char *value = args[i][2] ? &args[i][2] : args[++i];
+         warmup = value ? atoi(value) : -1;
+         i++;
+     }
+     int runs = args[i] ? atoi(args[i]) : 0;
+     if (runs <= 0 || warmup < 0 || !args[i + 1]) {
+         fprintf(stderr, "bench: usage: bench [-w WARMUP] N command...\n");
+         return 1;
+     }
+     if (pipeline->background) {
+         fprintf(stderr, "bench: cannot time a background command\n");
+         return 1;
+     }
+ 
+     struct pipeline timed = *pipeline;
+     struct command *stages = arenaAlloc(&lineArena, timed.count * sizeof *stages);
+     memcpy(stages, pipeline->stages, timed.count * sizeof *stages);
+     stages[0].args = &args[i + 1];
+     timed.stages = stages;
+     timed.timed = 0; // `time bench ...` reports the whole benchmark, not each run
+ 
+     for (int run = 0; run < warmup; run++) executeCommand(&timed);
+ 
+     double *samples = malloc(runs * sizeof *samples);
+     int failures = 0;
+     struct timespec first, start, end;
+     clock_gettime(CLOCK_MONOTONIC, &first);
+     for (int run = 0; run < runs; run++) {
+         clock_gettime(CLOCK_MONOTONIC, &start);
+         executeCommand(&timed);
+         clock_gettime(CLOCK_MONOTONIC, &end);
+         samples[run] = elapsedUs(&start, &end);
+         if (lastExitStatus != 0) failures++;
+     }
+ 
+     int status = lastExitStatus;
+     char *label = formatPipeline(&timed);
+     benchReport(label, samples, runs, elapsedUs(&first, &end), "cmds");
+     if (failures > 0) {
+         printf("  %d of %d runs failed\n", failures, runs);
+         flushOutput();
+     }
+     free(label);
+     free(samples);
+     return status;
+ }
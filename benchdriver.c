@@ -0,0 +1,263 @@
+/**
+ * @file benchdriver.c
+ * @brief `smallsh-bench`: drives the parser and launcher without a terminal.
+ *
+ *     smallsh-bench [-l LINES] [-f LINES] [-s LINES] [-x SHELL] [-n RUNS] [command line]
+ *
+ * 1. Lexes and parses LINES synthetic command lines (plain commands,
+ *    pipelines, redirections, long argument lists) and reports per-line
+ *    latency and lines per second.
+ * 2. With `-f`, lexes and parses LINES lines of random tokens and stray
+ *    quotes, `$`, `\` and operators, which the parser must reject or
+ *    accept without crashing, and reports lines per second.
+ * 3. With `-s`, writes a LINES-line script (builtins, assignments and
+ *    comments, with every LAUNCH_EVERY-th line starting a command, some
+ *    redirected and some with `&`), runs it through SHELL (default
+ *    `./smallsh`) in batch mode, and reports lines and launches per second.
+ *    The launched command is `/bin/true`, as a bare `true` runs in-process.
+ * 4. Runs `command line` (default `true`) RUNS times through
+ *    `executeCommand()` with each launch engine, with and without the
+ *    command hash table.
+ *
+ * Built and run by `make bench` (and `make throughput` for a 1M-line
+ * batch run); linked against the shell's objects, with smallsh.c compiled
+ * without its `main()`.
+ */
+
+ #include "smallsh.h"
+ 
+ #define LAUNCH_EVERY 100   // Script lines per launched command in the batch run
+ 
+ static const char *templates[] = {
+     "ls -l /tmp/dir%d\n",
+     "grep -n pattern%d < input.log | sort | uniq -c > counts%d.txt\n",
+     "cat /var/log/app%d.log | grep ERROR | tail -n 20 &\n",
+     "make -j8 target%d 2>&1 >> build.log\n",
+     "echo a%d b c d e f g h i j k l m n o p q r s t u v w x y z %d\n",
+     "  sort   -u   file%d    >   out   # trailing comment %d\n",
+     "test -d dir%d && make -C dir%d || echo skipped; echo done\n",
+ };
+ 
+ // Random line pieces for `-f`
+ static const char *pieces[] = {
+     "ls", "a%d", "-l", "|", "&", ";", "&&", "||", "<", ">", ">>", "2>&1", "<<<", "<<",
+     "'", "\"", "\\", "$", "$?", "${", "}", "${x%d}", "*", "?", "[a-", "#", "!", "x=%d", "\t",
+ };
+ 
+ // Script lines for `-s`: the first ones run nothing, the rest launch one command
+ static const char *quietLines[] = {
+     "# comment %d\n",
+     "v%d=value\n",
+     "cd .\n",
+     "status\n",
+     "w=\"$v%d and $HOME\"\n",
+ };
+ static const char *launchLines[] = {
+     "/bin/true\n",
+     "/bin/true a%d b c < /dev/null > /dev/null\n",
+     "/bin/true 2>&1 >> /dev/null\n",
+     "/bin/true %d &\n",
+ };
+ 
+ /**
+  * @brief Builds LINES synthetic command lines into one buffer.
+  */
+ static char *makeStream(int lines, size_t *len) {
+     int templateCount = sizeof templates / sizeof templates[0];
+     size_t cap = (size_t)lines * 96 + 1, used = 0;
+     char *stream = malloc(cap);
+ 
+     for (int i = 0; i < lines; i++) {
+         if (cap - used < 256) stream = realloc(stream, cap *= 2);
+         used += snprintf(stream + used, cap - used, templates[i % templateCount], i, i);
+     }
+     *len = used;
+     return stream;
+ }
+ 
+ /**
+  * @brief Times lexing and parsing of every line in the synthetic stream.
+  */
+ static void benchParse(int lines) {
+     size_t len;
+     char *stream = makeStream(lines, &len), *p = stream, *end = stream + len;
+     double *samples = malloc(lines * sizeof *samples);
+     struct timespec first, start, now;
+     int count = 0;
+ 
+     clock_gettime(CLOCK_MONOTONIC, &first);
+     while (p < end) {
+         char *newline = memchr(p, '\n', end - p);
+         size_t lineLen = newline ? (size_t)(newline - p + 1) : (size_t)(end - p);
+         struct token *tokens;
+         struct commandList list;
+ 
+         clock_gettime(CLOCK_MONOTONIC, &start);
+         arenaReset(&lineArena);
+         int tokenCount = lexLine(&lineArena, p, lineLen, &tokens);
+         if (parseList(&lineArena, tokens, tokenCount, &list)) {
+             fprintf(stderr, "smallsh-bench: syntax error in synthetic line: %.*s", (int)lineLen, p);
+         }
+         clock_gettime(CLOCK_MONOTONIC, &now);
+         samples[count++] = elapsedUs(&start, &now);
+         p += lineLen;
+     }
+ 
+     printf("%.1f MB of input\n", len / 1e6);
+     benchReport("lex+parse", samples, count, elapsedUs(&first, &now), "lines");
+     free(samples);
+     free(stream);
+ }
+ 
+ /**
+  * @brief Times lexing and parsing of LINES lines of random tokens.
+  */
+ static void benchRandomParse(int lines) {
+     int pieceCount = sizeof pieces / sizeof pieces[0], rejected = 0;
+     unsigned seed = 1;
+     double *samples = malloc(lines * sizeof *samples);
+     struct timespec first, start, now;
+     char line[1024];
+ 
+     clock_gettime(CLOCK_MONOTONIC, &first);
+     for (int i = 0; i < lines; i++) {
+         size_t len = 0;
+         int words = rand_r(&seed) % 24;
+         for (int w = 0; w < words; w++) {
+             len += snprintf(line + len, sizeof line - len, pieces[rand_r(&seed) % pieceCount], i);
+             if (rand_r(&seed) % 4) line[len++] = ' '; // Sometimes glued to the next piece
+         }
+         line[len++] = '\n';
+ 
+         struct token *tokens;
+         struct commandList list;
+         clock_gettime(CLOCK_MONOTONIC, &start);
+         arenaReset(&lineArena);
+         int tokenCount = lexLine(&lineArena, line, len, &tokens);
+         if (parseList(&lineArena, tokens, tokenCount, &list)) rejected++;
+         clock_gettime(CLOCK_MONOTONIC, &now);
+         samples[i] = elapsedUs(&start, &now);
+     }
+ 
+     benchReport("random lex+parse", samples, lines, elapsedUs(&first, &now), "lines");
+     printf("  %d of %d lines rejected as syntax errors\n", rejected, lines);
+     free(samples);
+ }
+ 
+ /**
+  * @brief Runs a generated LINES-line script through `shell` in batch mode.
+  */
+ static void benchBatch(const char *shell, int lines) {
+     int quietCount = sizeof quietLines / sizeof quietLines[0];
+     int launchCount = sizeof launchLines / sizeof launchLines[0], launches = 0;
+     char path[] = "/tmp/smallsh-bench-XXXXXX";
+     int fd = mkstemp(path);
+     if (fd == -1) {
+         perror("smallsh-bench: mkstemp");
+         return;
+     }
+     FILE *script = fdopen(fd, "w");
+     for (int i = 0; i < lines; i++) {
+         if (i % LAUNCH_EVERY == LAUNCH_EVERY - 1) {
+             fprintf(script, launchLines[launches++ % launchCount], i);
+         } else {
+             fprintf(script, quietLines[i % quietCount], i);
+         }
+     }
+     fclose(script);
+ 
+     struct timespec start, end;
+     int status = 0;
+     fflush(stdout);
+     clock_gettime(CLOCK_MONOTONIC, &start);
+     pid_t pid = fork();
+     if (pid == 0) {
+         int null = open("/dev/null", O_WRONLY);
+         dup2(null, STDOUT_FILENO);
+         execl(shell, shell, path, (char *)NULL);
+         perror(shell);
+         _exit(127);
+     }
+     if (pid > 0) waitpid(pid, &status, 0);
+     clock_gettime(CLOCK_MONOTONIC, &end);
+     unlink(path);
+ 
+     double secs = elapsedUs(&start, &end) / 1e6;
+     printf("batch: %d lines, %d launches in %.3fs, %.0f lines/s, %.1f launches/s\n",
+            lines, launches, secs, lines / secs, launches / secs);
+     if (pid == -1 || !WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+         printf("  %s did not exit cleanly (status %d)\n", shell, status);
+     }
+     flushOutput();
+ }
+ 
+ /**
+  * @brief Times RUNS launches of `line` with the current engine.
+  */
+ static void benchLaunch(const char *label, const char *line, int runs, int useHash) {
+     double *samples = malloc(runs * sizeof *samples);
+     struct timespec first, start, now;
+     int failures = 0;
+ 
+     clock_gettime(CLOCK_MONOTONIC, &first);
+     for (int i = 0; i < runs; i++) {
+         struct token *tokens;
+         struct pipeline pipeline;
+ 
+         clock_gettime(CLOCK_MONOTONIC, &start);
+         arenaReset(&lineArena);
+         int tokenCount = lexLine(&lineArena, line, strlen(line), &tokens);
+         if (parsePipeline(&lineArena, tokens, tokenCount, &pipeline) || pipeline.count == 0) {
+             fprintf(stderr, "smallsh-bench: cannot parse: %s\n", line);
+             exit(1);
+         }
+         if (!useHash) hashClear();
+         executeCommand(&pipeline);
+         clock_gettime(CLOCK_MONOTONIC, &now);
+         samples[i] = elapsedUs(&start, &now);
+         if (lastExitStatus != 0) failures++;
+     }
+ 
+     benchReport(label, samples, runs, elapsedUs(&first, &now), "cmds");
+     if (failures > 0) printf("  %d of %d runs failed\n", failures, runs);
+     free(samples);
+ }
+ 
+ int main(int argc, char *argv[]) {
+     int lines = 200000, randomLines = 0, scriptLines = 0, runs = 500, opt;
+     const char *shell = "./smallsh";
+ 
+     while ((opt = getopt(argc, argv, "l:f:s:x:n:")) != -1) {
+         switch (opt) {
+         case 'l': lines = atoi(optarg); break;
+         case 'f': randomLines = atoi(optarg); break;
+         case 's': scriptLines = atoi(optarg); break;
+         case 'x': shell = optarg; break;
+         case 'n': runs = atoi(optarg); break;
+         default:
+             fprintf(stderr, "usage: smallsh-bench [-l LINES] [-f LINES] [-s LINES] [-x SHELL] [-n RUNS] [command line]\n");
+             return 1;
+         }
+     }
+     char *line = optind < argc ? joinArgs(&argv[optind]) : "true";
+     varsInit(); // The command hash follows the shell's $PATH
+     setvbuf(stdout, NULL, _IOLBF, 0);
+ 
+     if (lines > 0) benchParse(lines);
+     if (randomLines > 0) benchRandomParse(randomLines);
+     if (scriptLines > 0) benchBatch(shell, scriptLines);
+     if (runs <= 0) return 0;
+ 
+     struct { const char *label; int mode; int useHash; } engines[] = {
+         { "posix_spawn", LAUNCH_SPAWN, 1 },
+         { "posix_spawn, no hash", LAUNCH_SPAWN, 0 },
+         { "fork+exec", LAUNCH_FORK, 1 },
+         { "fork+exec, no hash", LAUNCH_FORK, 0 },
+     };
+     printf("launching: %s\n", line);
+     for (int i = 0; i < (int)(sizeof engines / sizeof engines[0]); i++) {
+         launchMode = engines[i].mode;
+         benchLaunch(engines[i].label, line, runs, engines[i].useHash);
+     }
+     return 0;
+ }
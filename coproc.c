@@ -0,0 +1,204 @@
+/**
+ * @file coproc.c
+ * @brief Named coprocesses: long-lived children the shell talks to over pipes.
+ *
+ *     coproc NAME command [args...]   start NAME
+ *     send NAME [words...]            write one line to NAME's stdin
+ *     recv NAME [N]                   copy N lines (default 1) of NAME's stdout to stdout
+ *     coproc -c NAME                  close NAME's stdin so it can finish
+ *     coproc                          list coprocesses
+ *
+ * An interpreter started once this way serves many requests without a
+ * fork, exec and startup each time. Coprocesses are background jobs in the
+ * job table; `exit` closes their pipes before it signals the jobs. A
+ * coprocess that has finished is kept until `recv` has read the last of
+ * its output, so nothing it wrote is lost.
+ */
+
+ #include "smallsh.h"
+ 
+ struct coproc {
+     char *name;
+     pid_t pid;
+     int toChild;                 // Write end of the child's stdin, -1 once closed
+     struct lineReader fromChild; // Buffered read end of the child's stdout
+ };
+ 
+ static struct coproc *coprocs = NULL;
+ static int coprocCount = 0, coprocCap = 0;
+ 
+ /**
+  * @brief Closes a coprocess's pipes and removes it from the list.
+  */
+ static void coprocForget(struct coproc *co) {
+     if (co->toChild != -1) close(co->toChild);
+     readerClose(&co->fromChild);
+     free(co->name);
+     *co = coprocs[--coprocCount];
+ }
+ 
+ /**
+  * @brief Finds a coprocess by name, running or finished with output left to read.
+  *
+  * Prints an error naming `builtin` when there is no coprocess `name`.
+  */
+ static struct coproc *coprocFind(const char *builtin, const char *name) {
+     for (int i = 0; name && i < coprocCount; i++) {
+         if (strcmp(coprocs[i].name, name) == 0) return &coprocs[i];
+     }
+     fprintf(stderr, "%s: %s: no such coprocess\n", builtin, name ? name : "");
+     return NULL;
+ }
+ 
+ /**
+  * @brief Built-in `coproc`: starts, closes or lists coprocesses.
+  */
+ int coprocBuiltin(char *args[]) {
+     if (!args[1]) {
+         for (int i = 0; i < coprocCount; i++) {
+             struct job *job = jobFind(coprocs[i].pid);
+             printf("%s\t%d\t%s\n", coprocs[i].name, coprocs[i].pid, job ? job->command : "(done)");
+         }
+         flushOutput();
+         return 0;
+     }
+ 
+     if (strcmp(args[1], "-c") == 0) {
+         struct coproc *co = coprocFind("coproc", args[2]);
+         if (!co) return 1;
+         if (co->toChild != -1) close(co->toChild);
+         co->toChild = -1;
+         return 0;
+     }
+ 
+     if (!args[2]) {
+         fprintf(stderr, "coproc: usage: coproc NAME command [args...]\n");
+         return 1;
+     }
+     for (int i = 0; i < coprocCount; i++) {
+         if (strcmp(coprocs[i].name, args[1]) != 0) continue;
+         if (jobFind(coprocs[i].pid)) {
+             fprintf(stderr, "coproc: %s: already running\n", args[1]);
+             return 1;
+         }
+         coprocForget(&coprocs[i]); // Finished: the new one takes the name
+         break;
+     }
+ 
+     int toChild[2], fromChild[2];
+     if (pipe2(toChild, O_CLOEXEC) == -1) {
+         perror("pipe() failed");
+         return 1;
+     }
+     if (pipe2(fromChild, O_CLOEXEC) == -1) {
+         perror("pipe() failed");
+         close(toChild[0]);
+         close(toChild[1]);
+         return 1;
+     }
+ 
+     struct command cmd = { .args = &args[2] };
+     pid_t pid = launchCommand(&cmd, 1, toChild[0], fromChild[1], NULL);
+     close(toChild[0]);
+     close(fromChild[1]);
+     if (pid == -1) {
+         close(toChild[1]);
+         close(fromChild[0]);
+         return 1;
+     }
+ 
+     int status = W_EXITCODE(1, 0);
+     jobAdd(pid, &pid, &status, 1, joinArgs(&args[2]));
+ 
+     if (coprocCount == coprocCap) {
+         coprocCap = coprocCap ? coprocCap * 2 : 4;
+         coprocs = realloc(coprocs, coprocCap * sizeof *coprocs);
+     }
+     struct coproc *co = &coprocs[coprocCount++];
+     co->name = strdup(args[1]);
+     co->pid = pid;
+     co->toChild = toChild[1];
+     readerInit(&co->fromChild, fromChild[0]);
+ 
+     fprintf(noticeOutput(), "coprocess %s pid is %d\n", co->name, pid);
+     flushOutput();
+     return 0;
+ }
+ 
+ /**
+  * @brief Built-in `send NAME [words...]`: writes the words and a newline to NAME.
+  *
+  * SIGPIPE is blocked for the write, so a coprocess that has exited
+  * shows up as an error (EPIPE) instead of killing the shell; its unread
+  * output stays available to `recv`.
+  */
+ int sendBuiltin(char *args[]) {
+     struct coproc *co = coprocFind("send", args[1]);
+     if (!co) return 1;
+     if (co->toChild == -1) {
+         fprintf(stderr, "send: %s: input is closed\n", co->name);
+         return 1;
+     }
+ 
+     char *line = joinArgs(&args[2]);
+     size_t len = strlen(line);
+     line[len++] = '\n'; // joinArgs leaves room for a separator after the last word
+ 
+     sigset_t pipeSet, savedMask;
+     sigemptyset(&pipeSet);
+     sigaddset(&pipeSet, SIGPIPE);
+     sigprocmask(SIG_BLOCK, &pipeSet, &savedMask);
+ 
+     int status = 0;
+     for (size_t done = 0; done < len; ) {
+         ssize_t n = write(co->toChild, line + done, len - done);
+         if (n == -1 && errno == EINTR) continue;
+         if (n == -1) {
+             fprintf(stderr, "send: %s: %s\n", co->name, strerror(errno));
+             status = 1;
+             break;
+         }
+         done += n;
+     }
+ 
+     struct timespec noWait = {0};
+     while (sigtimedwait(&pipeSet, NULL, &noWait) > 0); // Discard the SIGPIPE we caused
+     sigprocmask(SIG_SETMASK, &savedMask, NULL);
+     free(line);
+     return status;
+ }
+ 
+ /**
+  * @brief Built-in `recv NAME [N]`: copies N lines (default 1) from NAME to stdout.
+  *
+  * Once a finished coprocess's output runs out, the coprocess is forgotten.
+  */
+ int recvBuiltin(char *args[]) {
+     struct coproc *co = coprocFind("recv", args[1]);
+     if (!co) return 1;
+ 
+     long lines = args[2] ? strtol(args[2], NULL, 10) : 1;
+     for (long i = 0; i < lines; i++) {
+         size_t len;
+         char *line = readLine(&co->fromChild, &len);
+         if (!line) {
+             fprintf(stderr, "recv: %s: end of output\n", co->name);
+             if (!jobFind(co->pid)) coprocForget(co);
+             flushOutput();
+             return 1;
+         }
+         fwrite(line, 1, len, stdout);
+         if (line[len - 1] != '\n') putchar('\n');
+     }
+     flushOutput();
+     return 0;
+ }
+ 
+ /**
+  * @brief Closes every coprocess's pipes (used by `exit`).
+  *
+  * Closing stdin lets well-behaved interpreters finish on their own.
+  */
+ void coprocCloseAll() {
+     while (coprocCount > 0) coprocForget(&coprocs[coprocCount - 1]);
+ }
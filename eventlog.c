@@ -0,0 +1,131 @@
+/**
+ * @file eventlog.c
+ * @brief Optional JSON-lines log of job events (`SMALLSH_EVENTS`).
+ *
+ *     SMALLSH_EVENTS=3            write records to descriptor 3
+ *     SMALLSH_EVENTS=jobs.jsonl   append records to a file
+ *
+ * One record per line, e.g.
+ *
+ *     {"event":"start","time":1700000000.123456,"job":1,"pgid":4242,"pids":[4242,4243],"command":"sleep 5 | cat"}
+ *     {"event":"exit","time":1700000005.130012,"job":1,"pgid":4242,"status":0,"duration_ms":5006.556,
+ *      "user_ms":0.812,"sys_ms":1.204,"maxrss_kb":1920,"command":"sleep 5 | cat"}
+ *
+ * (without the line break). `event` is `start` when a job enters the job
+ * table, `exit` or `signal` (with `signal` instead of `status`) when it
+ * finishes, and `stop` or `continue`. CPU times and peak RSS come from
+ * `wait4()` and cover every stage. Records are collected in a buffer that
+ * is written when it fills, after each round of reaping and before the
+ * next command line is read, so a burst of completions costs a few
+ * `write()` calls.
+ */
+
+ #include "smallsh.h"
+ 
+ #define EVENT_BUFFER 65536
+ #define EVENT_RECORD_MAX 8192     // Longer command lines are cut short in the record
+ 
+ static int eventFD = -1;
+ static char eventBuffer[EVENT_BUFFER];
+ static size_t eventUsed = 0;
+ 
+ /**
+  * @brief Opens the sink named by `SMALLSH_EVENTS`, if set.
+  *
+  * A number is taken as an inherited descriptor, anything else as a path.
+  * The sink is close-on-exec, so commands never write to it.
+  */
+ void eventLogInit() {
+     const char *target = getenv("SMALLSH_EVENTS");
+     if (!target || !*target) return;
+ 
+     char *end;
+     long fd = strtol(target, &end, 10);
+     if (*end == '\0') {
+         if (fcntl(fd, F_SETFD, FD_CLOEXEC) == -1) {
+             perror("SMALLSH_EVENTS");
+             return;
+         }
+         eventFD = fd;
+     } else {
+         eventFD = open(target, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+         if (eventFD == -1) perror(target);
+     }
+ }
+ 
+ /**
+  * @brief Writes out the buffered records.
+  */
+ void eventLogFlush() {
+     for (size_t done = 0; done < eventUsed; ) {
+         ssize_t n = write(eventFD, eventBuffer + done, eventUsed - done);
+         if (n == -1 && errno == EINTR) continue;
+         if (n <= 0) break; // Sink gone: drop what is left
+         done += n;
+     }
+     eventUsed = 0;
+ }
+ 
+ /**
+  * @brief Appends `text` as a JSON string, with quotes, stopping before `limit`.
+  */
+ static char *jsonString(char *out, const char *limit, const char *text) {
+     *out++ = '"';
+     for (; *text && out + 8 < limit; text++) {
+         unsigned char c = *text;
+         if (c == '"' || c == '\\') {
+             *out++ = '\\';
+             *out++ = c;
+         } else if (c < 0x20) {
+             out += sprintf(out, "\\u%04x", c);
+         } else {
+             *out++ = c;
+         }
+     }
+     *out++ = '"';
+     return out;
+ }
+ 
+ /**
+  * @brief Adds one record for `job` to the buffer.
+  *
+  * @param event Event name.
+  * @param status Wait status for `exit`/`signal`/`stop`, ignored for others.
+  */
+ void eventLogJob(const char *event, const struct job *job, int status) {
+     if (eventFD == -1) return;
+ 
+     char record[EVENT_RECORD_MAX], *p = record, *limit = record + sizeof record - 256;
+     struct timespec now;
+     clock_gettime(CLOCK_REALTIME, &now);
+     p += sprintf(p, "{\"event\":\"%s\",\"time\":%lld.%06ld,\"job\":%d,\"pgid\":%d", event,
+                  (long long)now.tv_sec, now.tv_nsec / 1000, job->id, job->pgid);
+ 
+     if (strcmp(event, "start") == 0) {
+         p += sprintf(p, ",\"pids\":[");
+         for (int i = 0; i < job->procCount && p + 16 < limit; i++) {
+             p += sprintf(p, "%s%d", i ? "," : "", job->pids[i]);
+         }
+         *p++ = ']';
+     } else if (strcmp(event, "exit") == 0 || strcmp(event, "signal") == 0) {
+         struct timespec end;
+         clock_gettime(CLOCK_MONOTONIC, &end);
+         if (WIFEXITED(status)) p += sprintf(p, ",\"status\":%d", WEXITSTATUS(status));
+         else p += sprintf(p, ",\"signal\":%d", WTERMSIG(status));
+         p += sprintf(p, ",\"duration_ms\":%.3f,\"user_ms\":%.3f,\"sys_ms\":%.3f,\"maxrss_kb\":%ld",
+                      elapsedUs(&job->start, &end) / 1e3, timevalUs(&job->usage.ru_utime) / 1e3,
+                      timevalUs(&job->usage.ru_stime) / 1e3, job->usage.ru_maxrss);
+     } else if (strcmp(event, "stop") == 0) {
+         p += sprintf(p, ",\"signal\":%d", WSTOPSIG(status));
+     }
+ 
+     p += sprintf(p, ",\"command\":");
+     p = jsonString(p, record + sizeof record - 4, job->command);
+     *p++ = '}';
+     *p++ = '\n';
+ 
+     size_t len = p - record;
+     if (eventUsed + len > sizeof eventBuffer) eventLogFlush();
+     memcpy(eventBuffer + eventUsed, record, len);
+     eventUsed += len;
+ }
@@ -0,0 +1,208 @@
+/**
+ * @file events.c
+ * @brief Event loop for smallsh: terminal input and signals.
+ *
+ * SIGCHLD, SIGTSTP and SIGINT are blocked in the shell and read from a
+ * signalfd, so they are handled in normal code instead of signal
+ * handlers. While waiting at the prompt, the shell sleeps in `epoll_wait()`
+ * on the terminal and the signalfd, so background job notices print as
+ * soon as the job finishes rather than at the next Enter. Tagged job
+ * output (see tagout.c) is watched the same way, at the prompt and while
+ * the shell waits for a child, so a job never blocks on a full pipe.
+ */
+
+ #include "smallsh.h"
+ #include <sys/epoll.h>
+ #include <sys/signalfd.h>
+ 
+ static int signalFD = -1;
+ static int epollFD = -1;
+ static int inputWatched = -1; // Descriptor registered with epollFD
+ static int tagFD = -1;        // Epoll set of tagged job output (see tagout.c)
+ static int waitEpollFD = -1;  // Signals and tagged output, for waitChild()
+ static int childPending = 0;  // SIGCHLD read by waitChild(), jobs not yet reaped
+ 
+ /**
+  * @brief Blocks the shell's signals and opens the signalfd.
+  *
+  * The dispositions are reset to their defaults, since the kernel drops
+  * ignored signals before the signalfd sees them. Both launch engines
+  * start children with an empty signal mask.
+  *
+  * @param inputFD Descriptor commands are read from, watched when interactive (`-1` for none).
+  */
+ void eventsInit(int inputFD) {
+     sigset_t handled;
+     sigemptyset(&handled);
+     sigaddset(&handled, SIGCHLD);
+     sigaddset(&handled, SIGTSTP);
+     sigaddset(&handled, SIGINT);
+     sigprocmask(SIG_BLOCK, &handled, NULL);
+     signal(SIGCHLD, SIG_DFL);
+     signal(SIGTSTP, SIG_DFL);
+     signal(SIGINT, SIG_DFL);
+ 
+     signalFD = signalfd(-1, &handled, SFD_NONBLOCK | SFD_CLOEXEC);
+     if (signalFD == -1) {
+         perror("signalfd() failed");
+         exit(1);
+     }
+ 
+     epollFD = epoll_create1(EPOLL_CLOEXEC);
+     struct epoll_event event = { .events = EPOLLIN };
+     event.data.fd = signalFD;
+     epoll_ctl(epollFD, EPOLL_CTL_ADD, signalFD, &event);
+     event.data.fd = inputFD;
+     if (epoll_ctl(epollFD, EPOLL_CTL_ADD, inputFD, &event) == 0) inputWatched = inputFD;
+ 
+     tagFD = tagInit();
+     waitEpollFD = epoll_create1(EPOLL_CLOEXEC);
+     event.data.fd = signalFD;
+     epoll_ctl(waitEpollFD, EPOLL_CTL_ADD, signalFD, &event);
+     if (tagFD != -1) {
+         event.data.fd = tagFD;
+         epoll_ctl(epollFD, EPOLL_CTL_ADD, tagFD, &event);
+         epoll_ctl(waitEpollFD, EPOLL_CTL_ADD, tagFD, &event);
+     }
+ }
+ 
+ /**
+  * @brief Reads the pending signals, toggling foreground-only mode on SIGTSTP.
+  *
+  * @param reap Set if a SIGCHLD arrived.
+  * @param printed Set if anything was printed.
+  * @param interrupt Set if a SIGINT arrived.
+  */
+ static void readSignals(int atPrompt, int *reap, int *printed, int *interrupt) {
+     struct signalfd_siginfo info[16];
+     ssize_t n;
+ 
+     while ((n = read(signalFD, info, sizeof info)) > 0) {
+         for (size_t i = 0; i < n / sizeof info[0]; i++) {
+             switch (info[i].ssi_signo) {
+             case SIGCHLD:
+                 *reap = 1;
+                 break;
+             case SIGTSTP:
+                 toggleForegroundOnly();
+                 *printed = 1;
+                 break;
+             case SIGINT:
+                 *interrupt = 1;
+                 if (atPrompt) {
+                     putchar('\n');
+                     *printed = 1;
+                 }
+                 break;
+             }
+         }
+     }
+ }
+ 
+ /**
+  * @brief Handles every signal that has arrived since the last call.
+  *
+  * SIGCHLD reaps background jobs, SIGTSTP toggles foreground-only mode and
+  * SIGINT at the prompt starts a fresh line. A SIGINT that arrived while a
+  * foreground command ran was meant for the command and is discarded.
+  * Tagged job output is copied out first, so a job's last lines come
+  * before its completion notice.
+  *
+  * @param atPrompt Set while the prompt is showing.
+  * @return Nonzero if anything was printed (so the prompt needs redrawing).
+  */
+ int handleSignals(int atPrompt) {
+     int printed = 0, reap = childPending, interrupt = 0;
+ 
+     childPending = 0;
+     readSignals(atPrompt, &reap, &printed, &interrupt);
+     int tagged = tagPoll(atPrompt && !printed);
+     if (reap && checkBackgroundProcesses(atPrompt && !printed && !tagged) > 0) printed = 1;
+     printed |= tagged;
+     fflush(stdout);
+     return printed;
+ }
+ 
+ /**
+  * @brief Waits at the prompt until `reader` has input, handling signals meanwhile.
+  *
+  * Redraws the prompt after any signal output.
+  */
+ void waitForInput(struct lineReader *reader) {
+     struct epoll_event events[3];
+ 
+     if (reader->fd != inputWatched) return; // Not pollable: just block in read()
+     while (!readerHasLine(reader)) {
+         int n = epoll_wait(epollFD, events, 3, -1);
+         if (n == -1 && errno == EINTR) continue;
+         if (n == -1) return;
+ 
+         int inputReady = 0;
+         for (int i = 0; i < n; i++) {
+             if (events[i].data.fd == signalFD) {
+                 if (handleSignals(1)) prompt();
+             } else if (events[i].data.fd == tagFD) {
+                 if (tagPoll(1)) prompt();
+             } else {
+                 inputReady = 1;
+             }
+         }
+         if (inputReady) return;
+     }
+ }
+ 
+ /**
+  * @brief Waits like `wait4()`, copying out tagged job output meanwhile.
+  *
+  * With no tagged job running and `interruptible` unset this is a plain blocking `wait4()`. Otherwise
+  * the shell sleeps on the signalfd and the job output pipes, so a tagged
+  * background job keeps running while the shell waits for something else.
+  * A SIGCHLD read here is remembered, and the next `handleSignals()` reaps.
+  *
+  * @param interruptible Give up on SIGINT, returning `-1` with `errno` set to `EINTR`.
+  */
+ static pid_t waitLoop(pid_t pid, int *status, int options, struct rusage *usage, int interruptible) {
+     struct epoll_event events[2];
+     int watch = tagStreamsOpen() || interruptible;
+ 
+     if (!watch || (options & WNOHANG)) return wait4(pid, status, options, usage);
+     for (;;) {
+         pid_t done = wait4(pid, status, options | WNOHANG, usage);
+         if (done != 0) return done;
+ 
+         int n = epoll_wait(waitEpollFD, events, 2, -1);
+         if (n == -1 && errno != EINTR) return wait4(pid, status, options, usage);
+         for (int i = 0; i < n; i++) {
+             if (events[i].data.fd == signalFD) {
+                 int reap = 0, printed = 0, interrupt = 0;
+                 readSignals(0, &reap, &printed, &interrupt);
+                 if (reap) childPending = 1;
+                 if (interrupt && interruptible) {
+                     errno = EINTR;
+                     return -1;
+                 }
+             } else {
+                 tagPoll(0);
+             }
+         }
+         if (!tagStreamsOpen() && !interruptible) return wait4(pid, status, options, usage);
+     }
+ }
+ 
+ /**
+  * @brief `wait4()` for the shell's own waits, copying out tagged job output meanwhile.
+  *
+  * A SIGINT that arrives meanwhile was meant for the foreground command and is discarded.
+  */
+ pid_t waitChild(pid_t pid, int *status, int options, struct rusage *usage) {
+     return waitLoop(pid, status, options, usage, 0);
+ }
+ 
+ /**
+  * @brief `waitChild()` that gives up on Ctrl+C, for builtins whose children do not get it themselves.
+  *
+  * @return As `wait4()`, or `-1` with `errno` set to `EINTR` once a SIGINT arrives.
+  */
+ pid_t waitChildInterruptible(pid_t pid, int *status, int options, struct rusage *usage) {
+     return waitLoop(pid, status, options, usage, 1);
+ }
@@ -0,0 +1,199 @@
+/**
+ * @file fastcat.c
+ * @brief In-process `cat` for plain file copies.
+ *
+ * Lines like `cat < big.log > out.log` only move bytes, so instead of
+ * launching `/bin/cat` the shell does the transfer itself, letting the
+ * kernel copy the data: `copy_file_range()` between regular files,
+ * `sendfile()` from a regular file, `splice()` when a pipe is involved,
+ * and a plain read/write loop otherwise. Disabled with `set +o fastcat`.
+ *
+ * Only a `cat` with a redirection qualifies, and only if it reads regular
+ * files (or a here-doc) and writes a regular file or a pipe, so an
+ * interactive `cat`, or one reading a FIFO or device that could block
+ * forever, is a real child that Ctrl+C can stop. The shell keeps SIGINT
+ * blocked for its signalfd, so the copy checks for a pending SIGINT
+ * between kernel calls instead and stops like an interrupted `cat`. A
+ * file read onto itself (`cat a >> a`) is also left to the real `cat`.
+ * SIGPIPE is blocked during the copy: a reader that goes away ends the
+ * copy with EPIPE rather than the shell.
+ */
+
+ #include "smallsh.h"
+ #include <sys/stat.h>
+ #include <sys/sendfile.h>
+ 
+ #define COPY_CHUNK (1 << 23) // Bytes requested per kernel copy call, between SIGINT checks
+ 
+ /**
+  * @brief Returns whether an error means "this copy method does not apply here".
+  */
+ static int unsupported(int err) {
+     return err == EINVAL || err == EXDEV || err == ENOSYS || err == EOPNOTSUPP || err == EBADF;
+ }
+ 
+ /**
+  * @brief Returns whether a SIGINT is waiting, setting `errno` to `EINTR` if so.
+  *
+  * The signal stays pending for `handleSignals()`, which discards it.
+  */
+ static int interrupted() {
+     sigset_t pending;
+     if (sigpending(&pending) == -1 || !sigismember(&pending, SIGINT)) return 0;
+     errno = EINTR;
+     return 1;
+ }
+ 
+ /**
+  * @brief Copies everything from `in` to `out`, using the cheapest method the fds allow.
+  *
+  * @return `0` on success, `-1` with `errno` set on error (`EINTR` after a SIGINT).
+  */
+ static int copyFD(int in, int out) {
+     struct stat inStat, outStat;
+     ssize_t n;
+ 
+     if (fstat(in, &inStat) == -1 || fstat(out, &outStat) == -1) return -1;
+ 
+     if (S_ISREG(inStat.st_mode) && S_ISREG(outStat.st_mode)) {
+         int copied = 0;
+         while ((n = interrupted() ? -1 : copy_file_range(in, NULL, out, NULL, COPY_CHUNK, 0)) > 0) copied = 1;
+         if (n == 0) return 0;
+         if (copied || !unsupported(errno)) return -1;
+     }
+ 
+     if (S_ISREG(inStat.st_mode)) {
+         int copied = 0;
+         while ((n = interrupted() ? -1 : sendfile(out, in, NULL, COPY_CHUNK)) > 0) copied = 1;
+         if (n == 0) return 0;
+         if (copied || !unsupported(errno)) return -1;
+     }
+ 
+     if (S_ISFIFO(inStat.st_mode) || S_ISFIFO(outStat.st_mode)) {
+         int copied = 0;
+         while ((n = interrupted() ? -1 : splice(in, NULL, out, NULL, COPY_CHUNK, SPLICE_F_MOVE)) > 0) copied = 1;
+         if (n == 0) return 0;
+         if (copied || !unsupported(errno)) return -1;
+     }
+ 
+     static char buffer[1 << 17];
+     while ((n = interrupted() ? -1 : read(in, buffer, sizeof buffer)) > 0) {
+         for (ssize_t done = 0; done < n; ) {
+             ssize_t w = write(out, buffer + done, n - done);
+             if (w == -1) return -1;
+             done += w;
+         }
+     }
+     return n == 0 ? 0 : -1;
+ }
+ 
+ /**
+  * @brief Returns whether `path` is a regular file other than the output (`out`, `NULL` if unknown).
+  *
+  * A file that cannot be examined is left to the real `cat` to report.
+  */
+ static int regularInput(const char *path, const struct stat *out) {
+     struct stat st;
+     if (stat(path, &st) == -1 || !S_ISREG(st.st_mode)) return 0;
+     return !out || st.st_dev != out->st_dev || st.st_ino != out->st_ino;
+ }
+ 
+ /**
+  * @brief Runs `cat [file ...]` with its redirections inside the shell.
+  *
+  * Only plain copies qualify: no options, no stderr redirection, no
+  * background execution, at least one of `<` and `>`, no reading of the
+  * shell's own stdin, and only the file types described above. Anything
+  * else is left to the real `cat`.
+  *
+  * @param cmd The command (`args[0]` is "cat").
+  * @param background Flag for background execution.
+  * @return Exit status, or `-1` if the command must be launched normally.
+  */
+ int fastCat(struct command *cmd, int background) {
+     int inputFD = STDIN_FILENO, outputFD = STDOUT_FILENO;
+     int status = 0;
+ 
+     if (!fastcat || (background && !foregroundOnly)) return -1;
+     if (cmd->errorFile || cmd->errorToOutput) return -1; // Our error messages would go to the wrong place
+     int inputRedirected = cmd->inputFile || cmd->inputText;
+     if (!inputRedirected && !cmd->outputFile) return -1;
+     if (!inputRedirected && !cmd->args[1]) return -1; // Would read the terminal
+     for (int i = 1; cmd->args[i]; i++) {
+         if (cmd->args[i][0] == '-' && cmd->args[i][1] != '\0') return -1;
+         if (!inputRedirected && strcmp(cmd->args[i], "-") == 0) return -1;
+     }
+ 
+     struct stat outStat;
+     int outKnown = cmd->outputFile ? stat(cmd->outputFile, &outStat) == 0 : fstat(STDOUT_FILENO, &outStat) == 0;
+     if (!cmd->outputFile && !outKnown) return -1;
+     if (outKnown && !S_ISREG(outStat.st_mode) && !S_ISFIFO(outStat.st_mode)) return -1;
+     const struct stat *out = outKnown ? &outStat : NULL;
+     if (cmd->inputFile && !cmd->inputText && !regularInput(cmd->inputFile, out)) return -1;
+     for (int i = 1; cmd->args[i]; i++) {
+         if (strcmp(cmd->args[i], "-") != 0 && !regularInput(cmd->args[i], out)) return -1;
+     }
+ 
+     // Handle input redirection
+     if (inputRedirected) {
+         inputFD = openInput(cmd);
+         if (inputFD == -1) {
+             perror("cannot open input file");
+             return 1;
+         }
+     }
+ 
+     // Handle output redirection
+     if (cmd->outputFile) {
+         outputFD = openOutput(cmd->outputFile, cmd->outputMode);
+         if (outputFD == -1) {
+             perror("cannot open output file");
+             if (inputFD != STDIN_FILENO) close(inputFD);
+             return 1;
+         }
+     }
+ 
+     fflush(stdout); // Keep earlier shell output ahead of the copied bytes
+     syncInputBeforeLaunch();
+ 
+     sigset_t pipeSet, savedMask;
+     sigemptyset(&pipeSet);
+     sigaddset(&pipeSet, SIGPIPE);
+     sigprocmask(SIG_BLOCK, &pipeSet, &savedMask);
+ 
+     // A SIGINT still pending from before this command was not meant for it
+     sigset_t intSet;
+     sigemptyset(&intSet);
+     sigaddset(&intSet, SIGINT);
+     struct timespec noWait = {0};
+     while (sigtimedwait(&intSet, NULL, &noWait) > 0);
+ 
+     int err = 0;
+     if (!cmd->args[1] && copyFD(inputFD, outputFD) == -1) {
+         err = errno;
+         if (err != EINTR && err != EPIPE) perror("cat");
+         status = 1;
+     }
+     for (int i = 1; cmd->args[i] && err != EINTR && err != EPIPE; i++) {
+         int fd = strcmp(cmd->args[i], "-") == 0 ? inputFD : open(cmd->args[i], O_RDONLY | O_CLOEXEC);
+         if (fd == -1 || copyFD(fd, outputFD) == -1) {
+             err = errno;
+             if (err != EINTR && err != EPIPE) fprintf(stderr, "cat: %s: %s\n", cmd->args[i], strerror(err));
+             status = 1;
+         }
+         if (fd != -1 && fd != inputFD) close(fd);
+     }
+ 
+     while (sigtimedwait(&pipeSet, NULL, &noWait) > 0); // Discard the SIGPIPE a closed reader caused
+     sigprocmask(SIG_SETMASK, &savedMask, NULL);
+     if (err == EINTR) { // Ctrl+C: report it the way a killed `cat` would be
+         fprintf(noticeOutput(), "terminated by signal %d\n", SIGINT);
+         flushOutput();
+         status = SIGINT;
+     }
+ 
+     if (inputFD != STDIN_FILENO) close(inputFD);
+     if (outputFD != STDOUT_FILENO) close(outputFD);
+     syncInputAfterWait();
+     return status;
+ }
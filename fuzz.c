@@ -0,0 +1,28 @@
+/**
+ * @file fuzz.c
+ * @brief `smallsh-fuzz`: libFuzzer entry point for the lexer and parser.
+ *
+ * Each input is lexed and parsed as one command line, then the line arena
+ * is reset, exactly as the shell handles a line it reads. Nothing is
+ * expanded or run. Built by `make fuzz` with clang and the address and
+ * undefined-behaviour sanitizers, linked against the shell's objects with
+ * smallsh.c compiled without its `main()`.
+ */
+
+ #include "smallsh.h"
+ #include <stdint.h>
+ 
+ /**
+  * @brief Lexes and parses `data` as a command line.
+  *
+  * @return Always `0`; a syntax error is a normal outcome.
+  */
+ int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size) {
+     struct token *tokens;
+     struct commandList list;
+ 
+     int tokenCount = lexLine(&lineArena, (const char *)data, size, &tokens);
+     parseList(&lineArena, tokens, tokenCount, &list);
+     arenaReset(&lineArena);
+     return 0;
+ }
@@ -0,0 +1,263 @@
+/**
+ * @file glob.c
+ * @brief Pathname expansion (`*`, `?`, `[...]`) with cached directory listings.
+ *
+ * A pattern is matched one `/`-separated component at a time with
+ * `fnmatch(FNM_PERIOD)`, so `*` skips dot files as in other shells.
+ * Listings are cached by directory device and inode, sorted once, and
+ * reused for as long as the directory's mtime is unchanged (adding,
+ * removing or renaming an entry updates it), so repeating a pattern
+ * against a large directory costs one `stat()` instead of a `readdir()`
+ * of every entry. Since listings are sorted, only the names starting with
+ * a component's literal prefix (`f09` in `f09*.log`) are tried at all.
+ * A directory changed less than a second or two before it
+ * was read is read again next time, since timestamps are too coarse to
+ * show a change made right after the read. Matches come out sorted; a pattern that matches nothing
+ * is left as it was written.
+ */
+
+ #include "smallsh.h"
+ #include <dirent.h>
+ #include <fnmatch.h>
+ #include <sys/stat.h>
+ 
+ #define DIR_CACHE_SLOTS 32
+ 
+ // One cached directory listing
+ struct dirListing {
+     dev_t dev;
+     ino_t ino;
+     struct timespec mtime;   // Directory mtime when it was read
+     int racy;                // Read within a second of that mtime, so not trusted
+     char **names;            // Entry names in strcmp() order, without `.` and `..`
+     int count;
+     char *block;             // Storage for the names
+     int inUse;
+ };
+ 
+ static struct dirListing dirCache[DIR_CACHE_SLOTS];
+ static int nextEvict = 0;
+ 
+ // Matches collected for one pattern
+ struct globResult {
+     char **paths;
+     int count, cap;
+ };
+ 
+ static int comparePaths(const void *a, const void *b) {
+     return strcmp(*(char *const *)a, *(char *const *)b);
+ }
+ 
+ /**
+  * @brief Reads `path` into `listing`, replacing what it held.
+  *
+  * @return `0`, or `-1` if the directory cannot be read.
+  */
+ static int readListing(struct dirListing *listing, const char *path, const struct stat *st) {
+     DIR *dir = opendir(path);
+     if (!dir) return -1;
+ 
+     size_t used = 0, cap = 4096;
+     char *block = malloc(cap);
+     size_t *offsets = NULL;
+     int count = 0, offsetCap = 0;
+     struct dirent *entry;
+     while ((entry = readdir(dir))) {
+         const char *name = entry->d_name;
+         if (name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'))) continue;
+         size_t len = strlen(name) + 1;
+         if (used + len > cap) {
+             while (used + len > cap) cap *= 2;
+             block = realloc(block, cap);
+         }
+         if (count == offsetCap) {
+             offsetCap = offsetCap ? offsetCap * 2 : 256;
+             offsets = realloc(offsets, offsetCap * sizeof *offsets);
+         }
+         memcpy(block + used, name, len);
+         offsets[count++] = used;
+         used += len;
+     }
+     closedir(dir);
+ 
+     free(listing->names);
+     free(listing->block);
+     listing->names = malloc((count + 1) * sizeof *listing->names);
+     for (int i = 0; i < count; i++) listing->names[i] = block + offsets[i];
+     qsort(listing->names, count, sizeof *listing->names, comparePaths);
+     free(offsets);
+ 
+     listing->block = block;
+     listing->count = count;
+     listing->dev = st->st_dev;
+     listing->ino = st->st_ino;
+     listing->mtime = st->st_mtim;
+     // Timestamps are coarse: an entry added right after the read may leave the mtime as it was
+     struct timespec now;
+     clock_gettime(CLOCK_REALTIME, &now);
+     listing->racy = now.tv_sec - st->st_mtim.tv_sec < 2;
+     listing->inUse = 1;
+     return 0;
+ }
+ 
+ /**
+  * @brief Returns the sorted listing of a directory, from the cache when it is current.
+  *
+  * @return Listing owned by the cache, or `NULL` if `path` is not a readable directory.
+  */
+ static struct dirListing *listDirectory(const char *path) {
+     struct stat st;
+     if (stat(path, &st) == -1 || !S_ISDIR(st.st_mode)) return NULL;
+ 
+     struct dirListing *listing = NULL;
+     for (int i = 0; i < DIR_CACHE_SLOTS; i++) {
+         if (dirCache[i].inUse && dirCache[i].dev == st.st_dev && dirCache[i].ino == st.st_ino) {
+             listing = &dirCache[i];
+             break;
+         }
+     }
+     if (listing && !listing->racy && listing->mtime.tv_sec == st.st_mtim.tv_sec
+         && listing->mtime.tv_nsec == st.st_mtim.tv_nsec) {
+         return listing;
+     }
+     if (!listing) {
+         listing = &dirCache[nextEvict];
+         nextEvict = (nextEvict + 1) % DIR_CACHE_SLOTS;
+     }
+     if (readListing(listing, path, &st) == -1) {
+         listing->inUse = 0;
+         return NULL;
+     }
+     return listing;
+ }
+ 
+ /**
+  * @brief Returns whether the first `len` bytes of `text` hold an unescaped `*`, `?` or `[`.
+  */
+ static int hasMeta(const char *text, size_t len) {
+     for (size_t i = 0; i < len; i++) {
+         if (text[i] == '\\' && i + 1 < len) i++;
+         else if (text[i] == '*' || text[i] == '?' || text[i] == '[') return 1;
+     }
+     return 0;
+ }
+ 
+ /**
+  * @brief Range of a sorted listing that can match `component`: the names
+  * starting with its literal prefix (everything before the first `*`, `?` or `[`).
+  */
+ static void prefixRange(const struct dirListing *listing, const char *component, int *first, int *last) {
+     char prefix[strlen(component) + 1];
+     size_t len = 0;
+     for (const char *c = component; *c && *c != '*' && *c != '?' && *c != '['; c++) {
+         if (*c == '\\' && c[1]) c++;
+         prefix[len++] = *c;
+     }
+     prefix[len] = '\0';
+ 
+     int lo = 0, hi = listing->count;
+     while (lo < hi) {
+         int mid = (lo + hi) / 2;
+         if (strcmp(listing->names[mid], prefix) < 0) lo = mid + 1;
+         else hi = mid;
+     }
+     *first = *last = lo;
+     while (*last < listing->count && strncmp(listing->names[*last], prefix, len) == 0) (*last)++;
+ }
+ 
+ static void addMatch(struct arena *arena, struct globResult *result, const char *path) {
+     if (result->count == result->cap) {
+         result->cap = result->cap ? result->cap * 2 : 16;
+         result->paths = realloc(result->paths, result->cap * sizeof *result->paths);
+     }
+     result->paths[result->count++] = arenaStrndup(arena, path, strlen(path));
+ }
+ 
+ /**
+  * @brief Matches the components in `rest` below the directory `prefix`.
+  *
+  * @param prefix Path built so far: empty, or ending in `/`.
+  * @param rest Remaining pattern components.
+  */
+ static void globFrom(struct arena *arena, struct globResult *result, const char *prefix, const char *rest) {
+     const char *slash = strchr(rest, '/');
+     size_t len = slash ? (size_t)(slash - rest) : strlen(rest), prefixLen = strlen(prefix);
+     char component[len + 1];
+     memcpy(component, rest, len);
+     component[len] = '\0';
+ 
+     if (!hasMeta(component, len)) {
+         // Literal component: drop its escapes and go on without reading the directory
+         char path[prefixLen + len + 2], *p = path + prefixLen;
+         memcpy(path, prefix, prefixLen);
+         for (size_t i = 0; i < len; i++) {
+             if (component[i] == '\\' && i + 1 < len) i++;
+             *p++ = component[i];
+         }
+         *p = '\0';
+         struct stat st;
+         if (!slash) {
+             if (lstat(path, &st) == 0) addMatch(arena, result, path);
+             return;
+         }
+         *p++ = '/';
+         *p = '\0';
+         globFrom(arena, result, path, slash + 1);
+         return;
+     }
+ 
+     struct dirListing *listing = listDirectory(prefixLen ? prefix : ".");
+     if (!listing) return;
+ 
+     int first, last;
+     prefixRange(listing, component, &first, &last);
+     if (!slash) {
+         for (int i = first; i < last; i++) {
+             if (fnmatch(component, listing->names[i], FNM_PERIOD) != 0) continue;
+             size_t nameLen = strlen(listing->names[i]);
+             char path[prefixLen + nameLen + 1];
+             memcpy(path, prefix, prefixLen);
+             memcpy(path + prefixLen, listing->names[i], nameLen + 1);
+             addMatch(arena, result, path);
+         }
+         return;
+     }
+ 
+     // Take the matching names first: descending may evict this listing from the cache
+     struct globResult below = {0};
+     for (int i = first; i < last; i++) {
+         if (fnmatch(component, listing->names[i], FNM_PERIOD) == 0) addMatch(arena, &below, listing->names[i]);
+     }
+     for (int i = 0; i < below.count; i++) {
+         size_t nameLen = strlen(below.paths[i]);
+         char path[prefixLen + nameLen + 2];
+         memcpy(path, prefix, prefixLen);
+         memcpy(path + prefixLen, below.paths[i], nameLen);
+         strcpy(path + prefixLen + nameLen, "/");
+         globFrom(arena, result, path, slash + 1);
+     }
+     free(below.paths);
+ }
+ 
+ /**
+  * @brief Expands a pattern into the paths it matches.
+  *
+  * In `pattern`, a backslash makes the next character literal; the word
+  * expander escapes quoted characters this way.
+  *
+  * @param arena Arena for the matched paths and their array.
+  * @param matches Set to the sorted matches.
+  * @return Number of matches (`0` if none).
+  */
+ int globExpand(struct arena *arena, const char *pattern, char ***matches) {
+     struct globResult result = {0};
+     if (pattern[0] == '/') globFrom(arena, &result, "/", pattern + 1);
+     else globFrom(arena, &result, "", pattern);
+ 
+     qsort(result.paths, result.count, sizeof *result.paths, comparePaths);
+     *matches = arenaAlloc(arena, (result.count + 1) * sizeof **matches);
+     if (result.count) memcpy(*matches, result.paths, result.count * sizeof **matches);
+     (*matches)[result.count] = NULL;
+     free(result.paths);
+     return result.count;
+ }
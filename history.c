@@ -0,0 +1,476 @@
+/**
+ * @file history.c
+ * @brief Persistent command history: an mmap'd ring file plus a prefix index.
+ *
+ *     history [N]     list the last N lines (all by default)
+ *     history -c      forget every line
+ *     !!  !N  !-N     re-run the last line, line N, or the Nth line back
+ *     !prefix         re-run the newest line starting with prefix
+ *     !?text          re-run the newest line containing text
+ *
+ * Interactive lines are appended to `$SMALLSH_HISTFILE` (default
+ * `~/.smallsh_history`), a sparse file holding a header and a ring of
+ * records. Each record carries its length at both ends, so the newest
+ * lines are reached by walking back from the head: opening the file only
+ * maps it, whatever it holds. `!prefix` uses a sorted index of distinct
+ * lines with a range-max tree over their sequence numbers, built on first
+ * use; lines added after that are kept in a short list searched first.
+ */
+
+ #include "smallsh.h"
+ #include <stdint.h>
+ #include <sys/file.h>
+ #include <sys/mman.h>
+ #include <sys/stat.h>
+ 
+ #define HISTORY_MAGIC 0x31545349484d53ULL  // "SMHIST1": "SMHIST", then the format version
+ #define HISTORY_KIND 0xffffffffffffULL     // Bytes of the magic that mark a smallsh history file
+ #define HISTORY_BYTES (64 << 20)           // Ring size of a new file, about a million lines
+ #define RECENT_MAX 4096                    // Lines added since the index was built, before rebuilding it
+ 
+ // File header; the ring starts right after it
+ struct historyHeader {
+     uint64_t magic;
+     uint64_t capacity;   // Ring size in bytes
+     uint64_t head;       // Offset where the next record goes
+     uint64_t tail;       // Offset of the oldest record
+     uint64_t wrapEnd;    // End of the records before the ring wrapped (0 if it has not)
+     uint64_t count;      // Records stored
+     uint64_t nextSeq;    // History number of the next line, from 1
+ };
+ 
+ // Record layout: struct historyRecord, the line padded to 8 bytes, then the
+ // record's total size as a uint64_t so it can be walked backwards
+ struct historyRecord {
+     uint64_t seq;
+     uint64_t len;
+ };
+ 
+ // One distinct line in the prefix index
+ struct indexEntry {
+     uint64_t offset;
+     uint64_t seq;
+ };
+ 
+ static struct historyHeader *header = NULL;
+ static char *ring;
+ static int historyFD = -1;
+ static int historyState = 0; // 0 not opened yet, 1 open, -1 disabled
+ 
+ static struct indexEntry *entries = NULL; // Sorted by line, newest copy of each
+ static uint32_t *maxTree = NULL;          // Segment tree of entry indices by seq
+ static size_t entryCount = 0, treeSize = 0;
+ static struct indexEntry recent[RECENT_MAX];
+ static int recentCount = 0;
+ 
+ /**
+  * @brief Bytes a record with a `len`-byte line takes in the ring.
+  */
+ static uint64_t recordSize(uint64_t len) {
+     return sizeof(struct historyRecord) + ((len + 7) & ~7ULL) + sizeof(uint64_t);
+ }
+ 
+ static struct historyRecord *recordAt(uint64_t offset) {
+     return (struct historyRecord *)(ring + offset);
+ }
+ 
+ static const char *recordText(uint64_t offset) {
+     return ring + offset + sizeof(struct historyRecord);
+ }
+ 
+ /**
+  * @brief Checks a history file header against the current format and the file size.
+  *
+  * Only the header is checked, so opening stays constant-time: the offsets
+  * must lie inside the ring, on record boundaries, and agree with each other.
+  */
+ static int headerValid(const struct historyHeader *h, uint64_t fileSize) {
+     if (h->magic != HISTORY_MAGIC) return 0; // Another format version
+     if (h->capacity == 0 || h->capacity % 8 || h->capacity > fileSize - sizeof *h) return 0;
+     if (h->head > h->capacity || h->tail > h->capacity || h->wrapEnd > h->capacity) return 0;
+     if ((h->head | h->tail | h->wrapEnd) % 8) return 0;
+     if (h->count > h->capacity / recordSize(1) || h->nextSeq <= h->count) return 0;
+     if (h->count == 0) return 1; // The offsets are reset by the next add
+     return h->head > h->tail ? h->wrapEnd == 0 : h->tail < h->wrapEnd;
+ }
+ 
+ /**
+  * @brief Maps the history file, creating it if needed.
+  *
+  * A smallsh history file whose header is damaged or from another format
+  * version is started afresh; any other file turns history off.
+  *
+  * @return `0`, or `-1` if history is unavailable.
+  */
+ static int historyOpen() {
+     if (historyState) return historyState == 1 ? 0 : -1;
+     historyState = -1;
+ 
+     char path[4096];
+     const char *file = getenv("SMALLSH_HISTFILE"), *home = getenv("HOME");
+     if (file && !*file) return -1; // SMALLSH_HISTFILE= turns history off
+     if (!file) {
+         if (!home) return -1;
+         snprintf(path, sizeof path, "%s/.smallsh_history", home);
+         file = path;
+     }
+ 
+     struct stat st;
+     historyFD = open(file, O_RDWR | O_CREAT | O_CLOEXEC, 0600);
+     if (historyFD == -1) {
+         perror(file);
+         return -1;
+     }
+     flock(historyFD, LOCK_EX); // Another shell may be creating or resetting it too
+     if (fstat(historyFD, &st) == -1) {
+         perror(file);
+         close(historyFD);
+         return -1;
+     }
+ 
+     struct historyHeader existing = {0};
+     int fresh = st.st_size == 0;
+     if (!fresh && (pread(historyFD, &existing, sizeof existing, 0) != sizeof existing
+                    || (existing.magic & HISTORY_KIND) != (HISTORY_MAGIC & HISTORY_KIND))) {
+         fprintf(stderr, "%s: not a smallsh history file, history is off\n", file);
+         close(historyFD);
+         return -1;
+     }
+     if (!fresh && !headerValid(&existing, st.st_size)) {
+         fprintf(stderr, "%s: damaged or outdated history file, starting a new one\n", file);
+         if (ftruncate(historyFD, 0) == -1) {
+             perror(file);
+             close(historyFD);
+             return -1;
+         }
+         fresh = 1;
+     }
+ 
+     uint64_t capacity = fresh ? HISTORY_BYTES : existing.capacity;
+     if (fresh && ftruncate(historyFD, sizeof existing + capacity) == -1) {
+         perror(file);
+         close(historyFD);
+         return -1;
+     }
+     void *map = mmap(NULL, sizeof existing + capacity, PROT_READ | PROT_WRITE, MAP_SHARED, historyFD, 0);
+     if (map == MAP_FAILED) {
+         perror(file);
+         close(historyFD);
+         return -1;
+     }
+ 
+     header = map;
+     ring = (char *)map + sizeof *header;
+     if (fresh) {
+         header->capacity = capacity;
+         header->nextSeq = 1;
+         header->magic = HISTORY_MAGIC;
+     }
+     flock(historyFD, LOCK_UN);
+     historyState = 1;
+     return 0;
+ }
+ 
+ /**
+  * @brief Drops the oldest record to make room.
+  */
+ static void dropOldest() {
+     header->tail += recordSize(recordAt(header->tail)->len);
+     header->count--;
+     if (header->tail == header->wrapEnd) {
+         header->tail = 0;
+         header->wrapEnd = 0;
+     }
+ }
+ 
+ /**
+  * @brief Appends one line to the history file.
+  *
+  * Other shells may share the file, so the update holds an exclusive
+  * `flock()`. Lines are stored without their newline.
+  */
+ void historyAdd(const char *line, size_t len) {
+     while (len > 0 && (line[len - 1] == '\n' || line[len - 1] == '\r')) len--;
+     if (len == 0 || historyOpen() == -1) return;
+ 
+     uint64_t size = recordSize(len);
+     if (size > header->capacity) return;
+     flock(historyFD, LOCK_EX);
+ 
+     // Find room for the record, wrapping to the start and dropping old lines as needed
+     while (1) {
+         if (header->count == 0) {
+             header->head = header->tail = header->wrapEnd = 0;
+             break;
+         }
+         if (header->head > header->tail) { // Live records are [tail, head)
+             if (header->head + size <= header->capacity) break;
+             header->wrapEnd = header->head;
+             header->head = 0;
+         } else { // Live records are [tail, wrapEnd) then [0, head)
+             if (header->head + size <= header->tail) break;
+             dropOldest();
+         }
+     }
+ 
+     uint64_t offset = header->head;
+     struct historyRecord *record = recordAt(offset);
+     record->seq = header->nextSeq++;
+     record->len = len;
+     memcpy(ring + offset + sizeof *record, line, len);
+     *(uint64_t *)(ring + offset + size - sizeof(uint64_t)) = size;
+     header->head = offset + size;
+     header->count++;
+     flock(historyFD, LOCK_UN);
+ 
+     if (!entries) return;
+     if (recentCount == RECENT_MAX) { // Fold the recent lines into a fresh index on next use
+         free(entries);
+         free(maxTree);
+         entries = NULL;
+         recentCount = 0;
+         return;
+     }
+     recent[recentCount].offset = offset;
+     recent[recentCount++].seq = record->seq;
+ }
+ 
+ /**
+  * @brief Offset of the record before the one starting at `end`, walking backwards.
+  */
+ static uint64_t previousRecord(uint64_t end) {
+     if (end == 0) end = header->wrapEnd;
+     return end - *(uint64_t *)(ring + end - sizeof(uint64_t));
+ }
+ 
+ /**
+  * @brief Offset of the record after the one at `offset`.
+  */
+ static uint64_t nextRecord(uint64_t offset) {
+     offset += recordSize(recordAt(offset)->len);
+     if (header->wrapEnd && offset == header->wrapEnd) offset = 0;
+     return offset;
+ }
+ 
+ /**
+  * @brief Checks that an indexed record has not been overwritten since.
+  */
+ static int entryValid(const struct indexEntry *entry) {
+     uint64_t oldest = header->nextSeq - header->count;
+     return entry->seq >= oldest && recordAt(entry->offset)->seq == entry->seq;
+ }
+ 
+ static int compareText(const char *a, size_t aLen, const char *b, size_t bLen) {
+     int diff = memcmp(a, b, aLen < bLen ? aLen : bLen);
+     if (diff) return diff;
+     return aLen < bLen ? -1 : aLen > bLen;
+ }
+ 
+ // Sorts by line, newest first among equal lines
+ static int compareEntries(const void *a, const void *b) {
+     const struct indexEntry *x = a, *y = b;
+     int diff = compareText(recordText(x->offset), recordAt(x->offset)->len,
+                            recordText(y->offset), recordAt(y->offset)->len);
+     if (diff) return diff;
+     return x->seq < y->seq ? 1 : x->seq > y->seq ? -1 : 0;
+ }
+ 
+ /**
+  * @brief Builds the prefix index over every stored line.
+  */
+ static void buildIndex() {
+     entries = malloc((header->count + 1) * sizeof *entries);
+     entryCount = 0;
+     uint64_t offset = header->tail;
+     for (uint64_t i = 0; i < header->count; i++) {
+         entries[entryCount].offset = offset;
+         entries[entryCount++].seq = recordAt(offset)->seq;
+         offset = nextRecord(offset);
+     }
+     qsort(entries, entryCount, sizeof *entries, compareEntries);
+ 
+     // Keep only the newest copy of each line
+     size_t kept = 0;
+     for (size_t i = 0; i < entryCount; i++) {
+         if (kept && compareText(recordText(entries[i].offset), recordAt(entries[i].offset)->len,
+                                 recordText(entries[kept - 1].offset), recordAt(entries[kept - 1].offset)->len) == 0) {
+             continue;
+         }
+         entries[kept++] = entries[i];
+     }
+     entryCount = kept;
+ 
+     // Leaves hold entry indices; each parent the index with the larger seq
+     treeSize = 1;
+     while (treeSize < entryCount) treeSize <<= 1;
+     maxTree = malloc(2 * treeSize * sizeof *maxTree);
+     for (size_t i = 0; i < treeSize; i++) maxTree[treeSize + i] = i < entryCount ? i : UINT32_MAX;
+     for (size_t i = treeSize - 1; i > 0; i--) {
+         uint32_t left = maxTree[2 * i], right = maxTree[2 * i + 1];
+         if (left == UINT32_MAX) maxTree[i] = right;
+         else if (right == UINT32_MAX) maxTree[i] = left;
+         else maxTree[i] = entries[left].seq > entries[right].seq ? left : right;
+     }
+     recentCount = 0;
+ }
+ 
+ /**
+  * @brief First index entry not less than `text` (`upper` unset), or whose
+  * first `len` bytes are greater than `text` (`upper` set).
+  */
+ static size_t searchIndex(const char *text, size_t len, int upper) {
+     size_t lo = 0, hi = entryCount;
+     while (lo < hi) {
+         size_t mid = (lo + hi) / 2;
+         uint64_t midLen = recordAt(entries[mid].offset)->len;
+         int diff = upper ? compareText(recordText(entries[mid].offset), midLen < len ? midLen : len, text, len)
+                          : compareText(recordText(entries[mid].offset), midLen, text, len);
+         if (upper ? diff <= 0 : diff < 0) lo = mid + 1;
+         else hi = mid;
+     }
+     return lo;
+ }
+ 
+ /**
+  * @brief Newest line starting with `prefix`.
+  *
+  * @return Record offset, or `-1` if none.
+  */
+ static int64_t findPrefix(const char *prefix, size_t len) {
+     for (int i = recentCount - 1; i >= 0; i--) { // Newer than anything in the index
+         const struct historyRecord *record = recordAt(recent[i].offset);
+         if (entryValid(&recent[i]) && record->len >= len && memcmp(recordText(recent[i].offset), prefix, len) == 0) {
+             return recent[i].offset;
+         }
+     }
+     if (!entries) buildIndex();
+ 
+     // Range-max query over the matching entries [lo, hi)
+     size_t lo = searchIndex(prefix, len, 0) + treeSize, hi = searchIndex(prefix, len, 1) + treeSize;
+     uint32_t best = UINT32_MAX;
+     for (; lo < hi; lo >>= 1, hi >>= 1) {
+         uint32_t candidates[2] = { lo & 1 ? maxTree[lo++] : UINT32_MAX, hi & 1 ? maxTree[--hi] : UINT32_MAX };
+         for (int i = 0; i < 2; i++) {
+             if (candidates[i] != UINT32_MAX && (best == UINT32_MAX || entries[candidates[i]].seq > entries[best].seq)) {
+                 best = candidates[i];
+             }
+         }
+     }
+     // If the newest match was overwritten, every older one was too
+     if (best == UINT32_MAX || !entryValid(&entries[best])) return -1;
+     return entries[best].offset;
+ }
+ 
+ /**
+  * @brief Newest line containing `text` (any line if `text` is `NULL`), walking back.
+  *
+  * @param skip Number of newest records to step over first.
+  * @return Record offset, or `-1` if none.
+  */
+ static int64_t findBack(uint64_t skip, const char *text, size_t len) {
+     uint64_t offset = header->head;
+     for (uint64_t i = 0; i < header->count; i++) {
+         offset = previousRecord(offset);
+         if (i < skip) continue;
+         if (!text || memmem(recordText(offset), recordAt(offset)->len, text, len)) return offset;
+     }
+     return -1;
+ }
+ 
+ /**
+  * @brief Expands a `!` event at the start of an interactive line.
+  *
+  * The event word is replaced by the line it names and the rest of the line
+  * is kept, so `!make -j8` re-runs the last `make ...` with `-j8` appended.
+  * An expanded line is echoed, as other shells do.
+  *
+  * @param arena Arena for the expanded line.
+  * @param line Line as read, not NUL-terminated.
+  * @param len In: length of `line`. Out: length of the result.
+  * @return The line itself, its expansion, or `NULL` after printing that no line matched.
+  */
+ char *historyExpand(struct arena *arena, char *line, size_t *len) {
+     size_t start = 0;
+     while (start < *len && (line[start] == ' ' || line[start] == '\t')) start++;
+     if (start + 1 >= *len || line[start] != '!' || strchr(" \t\n\r=", line[start + 1])) return line;
+ 
+     size_t end = start + 1;
+     while (end < *len && !strchr(" \t\n\r", line[end])) end++;
+     size_t eventLen = end - start - 1;
+     const char *event = arenaStrndup(arena, line + start + 1, eventLen);
+ 
+     int64_t offset = -1;
+     if (historyOpen() == 0 && header->count > 0) {
+         uint64_t newest = header->nextSeq - 1, oldest = header->nextSeq - header->count;
+         char *numberEnd;
+         long long number = strtoll(event, &numberEnd, 10);
+         if (eventLen == 1 && event[0] == '!') {
+             offset = findBack(0, NULL, 0);
+         } else if (numberEnd == event + eventLen && number < 0) {
+             if ((uint64_t)-number <= header->count) offset = findBack(-number - 1, NULL, 0);
+         } else if (numberEnd == event + eventLen) {
+             if (number >= (long long)oldest && number <= (long long)newest) offset = findBack(newest - number, NULL, 0);
+         } else if (event[0] == '?') {
+             offset = findBack(0, event + 1, eventLen - 1);
+         } else {
+             offset = findPrefix(event, eventLen);
+         }
+     }
+     if (offset == -1) {
+         fprintf(stderr, "%.*s: event not found\n", (int)(eventLen + 1), line + start);
+         return NULL;
+     }
+ 
+     uint64_t textLen = recordAt(offset)->len;
+     size_t restLen = *len - end;
+     char *expanded = arenaAlloc(arena, textLen + restLen + 1);
+     memcpy(expanded, recordText(offset), textLen);
+     memcpy(expanded + textLen, line + end, restLen);
+     *len = textLen + restLen;
+     expanded[*len] = '\0';
+     printf("%s%s", expanded, *len && expanded[*len - 1] == '\n' ? "" : "\n");
+     flushOutput();
+     return expanded;
+ }
+ 
+ /**
+  * @brief Built-in `history` command: lists or clears stored lines.
+  *
+  * @return Exit status.
+  */
+ int historyBuiltin(char **args) {
+     if (historyOpen() == -1) return 1;
+ 
+     if (args[1] && strcmp(args[1], "-c") == 0) {
+         flock(historyFD, LOCK_EX);
+         header->head = header->tail = header->wrapEnd = header->count = 0;
+         flock(historyFD, LOCK_UN);
+         free(entries);
+         free(maxTree);
+         entries = NULL;
+         recentCount = 0;
+         return 0;
+     }
+ 
+     uint64_t show = header->count;
+     if (args[1]) {
+         char *end;
+         long long n = strtoll(args[1], &end, 10);
+         if (*end || n < 0) {
+             fprintf(stderr, "history: %s: numeric argument required\n", args[1]);
+             return 1;
+         }
+         if ((uint64_t)n < show) show = n;
+     }
+ 
+     // Step back to the first line to show, then print forwards
+     uint64_t offset = header->head;
+     for (uint64_t i = 0; i < show; i++) offset = previousRecord(offset);
+     for (uint64_t i = 0; i < show; i++) {
+         const struct historyRecord *record = recordAt(offset);
+         printf("%5llu  %.*s\n", (unsigned long long)record->seq, (int)record->len, recordText(offset));
+         offset = nextRecord(offset);
+     }
+     flushOutput();
+     return 0;
+ }
@@ -0,0 +1,193 @@
+/**
+ * @file input.c
+ * @brief Line input for smallsh.
+ *
+ * Scripts given as a regular file (`smallsh script.sh` or `smallsh < script`)
+ * are mapped with `mmap()` and split into lines in place. Other inputs
+ * (terminals, pipes) are read through a large buffer, so batch input costs
+ * one `read()` per 64 KiB instead of one per line.
+ */
+
+ #include "smallsh.h"
+ #include <sys/mman.h>
+ #include <sys/stat.h>
+ 
+ #define READ_CHUNK (64 * 1024)
+ 
+ // When the mapped script is the shell's own stdin, children that inherit
+ // stdin must see the file offset at the next unread line, as they would
+ // with an unbuffered shell.
+ static struct lineReader *stdinScript = NULL;
+ 
+ /**
+  * @brief Prepares `reader` to read lines from `fd`.
+  *
+  * Regular files are mapped from their current offset; anything else is
+  * read through a buffer.
+  */
+ void readerInit(struct lineReader *reader, int fd) {
+     struct stat st;
+     off_t offset;
+ 
+     memset(reader, 0, sizeof *reader);
+     reader->fd = fd;
+ 
+     if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0
+         && (offset = lseek(fd, 0, SEEK_CUR)) != -1) {
+         char *map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+         if (map != MAP_FAILED) {
+             madvise(map, st.st_size, MADV_SEQUENTIAL);
+             reader->map = map;
+             reader->mapLen = st.st_size;
+             reader->pos = offset;
+             if (fd == STDIN_FILENO) stdinScript = reader;
+             return;
+         }
+     }
+ 
+     reader->cap = READ_CHUNK;
+     reader->buffer = malloc(reader->cap);
+ }
+ 
+ /**
+  * @brief Prepares `reader` to read lines from an in-memory string, for `smallsh -c`.
+  *
+  * The string is used in place like a mapped file; the reader must not be closed.
+  */
+ void readerInitString(struct lineReader *reader, char *text, size_t len) {
+     memset(reader, 0, sizeof *reader);
+     reader->fd = -1;
+     reader->map = text;
+     reader->mapLen = len;
+ }
+ 
+ /**
+  * @brief Returns the next line, including its newline if it has one.
+  *
+  * The line is not NUL-terminated and stays valid until the next call.
+  *
+  * @param len Set to the line length.
+  * @return Pointer to the line, or `NULL` at end of input.
+  */
+ char *readLine(struct lineReader *reader, size_t *len) {
+     if (reader->map) {
+         if (reader->pos >= reader->mapLen) return NULL;
+         char *line = reader->map + reader->pos;
+         char *newline = memchr(line, '\n', reader->mapLen - reader->pos);
+         *len = newline ? (size_t)(newline - line + 1) : reader->mapLen - reader->pos;
+         reader->pos += *len;
+         return line;
+     }
+ 
+     while (1) {
+         char *line = reader->buffer + reader->start;
+         char *newline = memchr(line, '\n', reader->end - reader->start);
+         if (newline) {
+             *len = newline - line + 1;
+             reader->start += *len;
+             return line;
+         }
+ 
+         // Move the partial line to the front, growing the buffer if it is full
+         if (reader->start > 0) {
+             memmove(reader->buffer, line, reader->end - reader->start);
+             reader->end -= reader->start;
+             reader->start = 0;
+         }
+         if (reader->end == reader->cap) {
+             reader->cap *= 2;
+             reader->buffer = realloc(reader->buffer, reader->cap);
+         }
+ 
+         ssize_t n = read(reader->fd, reader->buffer + reader->end, reader->cap - reader->end);
+         if (n == -1 && errno == EINTR) continue;
+         if (n <= 0) {
+             if (reader->end == 0) return NULL;
+             *len = reader->end; // Last line has no newline
+             reader->start = reader->end = 0;
+             return reader->buffer;
+         }
+         reader->end += n;
+     }
+ }
+ 
+ /**
+  * @brief Tells whether `readLine()` can return without reading more input.
+  */
+ int readerHasLine(struct lineReader *reader) {
+     if (reader->map) return 1;
+     return memchr(reader->buffer + reader->start, '\n', reader->end - reader->start) != NULL;
+ }
+ 
+ /**
+  * @brief Reads the bodies of the pipeline's `<<` here-docs from `reader`.
+  *
+  * Bodies follow the command line in stage order, each ending at a line
+  * that is exactly its delimiter. The text is copied into the line arena
+  * as the stage's `inputText`; nothing touches the disk.
+  */
+ void readHereDocs(struct lineReader *reader, struct pipeline *pipeline) {
+     for (int i = 0; i < pipeline->count; i++) {
+         struct command *stage = &pipeline->stages[i];
+         if (!stage->hereDelimiter) continue;
+ 
+         size_t delimLen = strlen(stage->hereDelimiter), used = 0, cap = 0;
+         char *body = NULL;
+         while (1) {
+             if (interactive) {
+                 printf("> ");
+                 fflush(stdout);
+             }
+             size_t len;
+             char *line = readLine(reader, &len);
+             if (!line) {
+                 fprintf(stderr, "warning: here-document delimited by end-of-file (wanted `%s')\n",
+                         stage->hereDelimiter);
+                 break;
+             }
+             size_t textLen = len > 0 && line[len - 1] == '\n' ? len - 1 : len;
+             if (textLen == delimLen && memcmp(line, stage->hereDelimiter, delimLen) == 0) break;
+ 
+             if (used + len + 1 > cap) {
+                 cap = (used + len + 1) * 2;
+                 body = realloc(body, cap);
+             }
+             memcpy(body + used, line, len);
+             used += len;
+             if (textLen == len) body[used++] = '\n'; // Last line of the input had none
+         }
+ 
+         stage->inputText = arenaStrndup(&lineArena, body ? body : "", used);
+         stage->inputLen = used;
+         stage->hereDelimiter = NULL;
+         free(body);
+     }
+ }
+ 
+ /**
+  * @brief Releases a reader and closes its descriptor.
+  */
+ void readerClose(struct lineReader *reader) {
+     if (reader->map) munmap(reader->map, reader->mapLen);
+     free(reader->buffer);
+     if (stdinScript == reader) stdinScript = NULL;
+     close(reader->fd);
+ }
+ 
+ /**
+  * @brief Moves stdin's file offset to the next unread script line.
+  *
+  * Called before starting a child that shares the shell's stdin.
+  */
+ void syncInputBeforeLaunch() {
+     if (stdinScript) lseek(STDIN_FILENO, stdinScript->pos, SEEK_SET);
+ }
+ 
+ /**
+  * @brief Continues the script from wherever a foreground child left stdin.
+  */
+ void syncInputAfterWait() {
+     if (!stdinScript) return;
+     off_t offset = lseek(STDIN_FILENO, 0, SEEK_CUR);
+     if (offset != -1) stdinScript->pos = offset;
+ }
@@ -0,0 +1,733 @@
+/**
+ * @file jobs.c
+ * @brief Background job table for smallsh.
+ *
+ * Jobs live in a growable slot array. Freed slots are chained on a free
+ * list and reused, and an open-addressing hash maps pids to slots, so
+ * adding, removing and finding a job are O(1) no matter how many jobs a
+ * session has started. A job's number (`%n`) is its slot index plus one.
+ *
+ * Also holds SIGCHLD-driven reaping, terminal job control and the `jobs`,
+ * `fg`, `bg`, `wait` and `kill` builtins. The statuses of background jobs
+ * reaped while nothing was waiting for them are kept (the last
+ * FINISHED_MAX), so a later `wait` still gets them. Jobs started by `par` live here
+ * too but are reaped by the runner.
+ *
+ * With job control (an interactive shell on its controlling terminal),
+ * every job runs in its own process group. The terminal is handed to a
+ * foreground job with `tcsetpgrp()`, so Ctrl+C and Ctrl+Z reach the whole
+ * job and never the shell, and one `kill(-pgid)` signals an entire pipeline.
+ */
+
+ #include "smallsh.h"
+ #include <termios.h>
+ 
+ #define PID_EMPTY 0
+ #define PID_TOMBSTONE -1
+ #define FINISHED_MAX 64
+ 
+ static struct job *slots = NULL;  // Slot array, indexed by job id - 1
+ static int slotCap = 0;
+ static int freeHead = -1;         // First unused slot, linked through nextFree
+ static int jobCount = 0;          // Slots currently in use
+ 
+ struct pidCell {
+     pid_t pid;                    // PID_EMPTY, PID_TOMBSTONE or a live key
+     int slot;
+ };
+ 
+ static struct pidCell *pidIndex = NULL; // Open-addressing pid -> slot map
+ static int pidCap = 0;            // Power of two
+ static int pidUsed = 0;           // Live keys plus tombstones
+ static int pidLive = 0;           // Live keys
+ 
+ int jobControl = 0;               // Jobs get process groups and the terminal
+ pid_t shellPgid = 0;
+ static struct termios shellModes; // Terminal modes restored when the shell takes the terminal back
+ 
+ // Notifications queued by reaping, printed before the next prompt
+ static struct { pid_t pid; int status; } *notices = NULL;
+ static int noticeCount = 0, noticeCap = 0;
+ 
+ // Statuses of jobs that finished unwaited, oldest first, for `wait`
+ static struct { int id; pid_t pgid; int status; } finished[FINISHED_MAX];
+ static int finishedStart = 0, finishedCount = 0;
+ 
+ /**
+  * @brief Inserts `pid -> slot` into the pid index, rehashing it at half load.
+  *
+  * The rehash drops the tombstones. It only doubles the index when the live
+  * keys need the room, so the size follows the jobs running now rather than
+  * every job the session has started.
+  */
+ static void pidIndexPut(pid_t pid, int slot) {
+     if ((pidUsed + 1) * 2 > pidCap) {
+         int oldCap = pidCap;
+         struct pidCell *old = pidIndex;
+ 
+         if (pidCap == 0) pidCap = 64;
+         else if ((pidLive + 1) * 4 > pidCap) pidCap *= 2; // Else mostly tombstones: same size
+         pidIndex = calloc(pidCap, sizeof *pidIndex);
+         pidUsed = pidLive = 0;
+         for (int i = 0; i < oldCap; i++) {
+             if (old[i].pid > 0) pidIndexPut(old[i].pid, old[i].slot);
+         }
+         free(old);
+     }
+ 
+     unsigned i = (unsigned)pid * 2654435761u & (pidCap - 1);
+     while (pidIndex[i].pid > 0) i = (i + 1) & (pidCap - 1);
+     if (pidIndex[i].pid == PID_EMPTY) pidUsed++;
+     pidLive++;
+     pidIndex[i].pid = pid;
+     pidIndex[i].slot = slot;
+ }
+ 
+ /**
+  * @brief Finds the pid index cell holding `pid`, or `-1`.
+  */
+ static int pidIndexFind(pid_t pid) {
+     if (pidCap == 0) return -1;
+     unsigned i = (unsigned)pid * 2654435761u & (pidCap - 1);
+     while (pidIndex[i].pid != PID_EMPTY) {
+         if (pidIndex[i].pid == pid) return i;
+         i = (i + 1) & (pidCap - 1);
+     }
+     return -1;
+ }
+ 
+ /**
+  * @brief Removes `pid` from the pid index, leaving a tombstone.
+  */
+ static void pidIndexRemove(pid_t pid) {
+     int cell = pid > 0 ? pidIndexFind(pid) : -1;
+     if (cell == -1) return;
+     pidIndex[cell].pid = PID_TOMBSTONE;
+     pidLive--;
+ }
+ 
+ /**
+  * @brief Records a newly started background job.
+  *
+  * @param pgid Process group of the job (pid of its first stage).
+  * @param pids Pid of each stage, `0` for stages that failed to start.
+  * @param statuses Initial wait status of each stage (kept for stages that never started).
+  * @param count Number of stages.
+  * @param command Command line for `jobs`; the table takes ownership.
+  * @return The new job. Pointers stay valid until the next `jobAdd()`.
+  */
+ struct job *jobAdd(pid_t pgid, const pid_t *pids, const int *statuses, int count, char *command) {
+     if (freeHead == -1) {
+         int oldCap = slotCap;
+         slotCap = slotCap ? slotCap * 2 : 16;
+         slots = realloc(slots, slotCap * sizeof *slots);
+         for (int i = slotCap - 1; i >= oldCap; i--) {
+             slots[i].inUse = 0;
+             slots[i].nextFree = freeHead;
+             freeHead = i;
+         }
+     }
+ 
+     int slot = freeHead;
+     struct job *job = &slots[slot];
+     freeHead = job->nextFree;
+ 
+     job->id = slot + 1;
+     job->pgid = pgid;
+     job->pids = malloc(count * sizeof *job->pids);
+     job->statuses = malloc(count * sizeof *job->statuses);
+     job->procCount = count;
+     job->liveCount = 0;
+     for (int i = 0; i < count; i++) {
+         job->pids[i] = pids[i];
+         job->statuses[i] = statuses[i];
+         if (pids[i] > 0) {
+             pidIndexPut(pids[i], slot);
+             job->liveCount++;
+         }
+     }
+     job->state = JOB_RUNNING;
+     job->parallel = 0;
+     job->command = command;
+     job->placedCPU = job->placedNode = -1;
+     job->inUse = 1;
+     memset(&job->usage, 0, sizeof job->usage);
+     clock_gettime(CLOCK_MONOTONIC, &job->start);
+     jobCount++;
+     eventLogJob("start", job, 0);
+     return job;
+ }
+ 
+ /**
+  * @brief Looks up a job by the pid of any of its stages.
+  */
+ struct job *jobFind(pid_t pid) {
+     int cell = pidIndexFind(pid);
+     return cell == -1 ? NULL : &slots[pidIndex[cell].slot];
+ }
+ 
+ /**
+  * @brief Looks up a job by job number (`%n`).
+  */
+ struct job *jobGet(int id) {
+     if (id < 1 || id > slotCap || !slots[id - 1].inUse) return NULL;
+     return &slots[id - 1];
+ }
+ 
+ /**
+  * @brief Releases a job's slot and pid index entries.
+  */
+ void jobRemove(struct job *job) {
+     for (int i = 0; i < job->procCount; i++) pidIndexRemove(job->pids[i]);
+ 
+     free(job->pids);
+     free(job->statuses);
+     free(job->command);
+     job->inUse = 0;
+     job->nextFree = freeHead;
+     freeHead = job->id - 1;
+     jobCount--;
+ }
+ 
+ /**
+  * @brief Returns the `i`th slot if it holds a job (for iteration).
+  *
+  * Callers loop `i` from `0` to `jobSlotCount()`.
+  */
+ struct job *jobAt(int i) {
+     return slots[i].inUse ? &slots[i] : NULL;
+ }
+ 
+ int jobSlotCount() {
+     return slotCap;
+ }
+ 
+ /**
+  * @brief Queues a notification for `printNotifications()`.
+  */
+ static void queueNotice(pid_t pgid, int status) {
+     if (noticeCount == noticeCap) {
+         noticeCap = noticeCap ? noticeCap * 2 : 16;
+         notices = realloc(notices, noticeCap * sizeof *notices);
+     }
+     notices[noticeCount].pid = pgid;
+     notices[noticeCount].status = status;
+     noticeCount++;
+ }
+ 
+ /**
+  * @brief Keeps a finished job's status for `wait`, dropping the oldest one when full.
+  */
+ static void rememberFinished(int id, pid_t pgid, int status) {
+     if (finishedCount == FINISHED_MAX) {
+         finishedStart = (finishedStart + 1) % FINISHED_MAX;
+         finishedCount--;
+     }
+     int i = (finishedStart + finishedCount++) % FINISHED_MAX;
+     finished[i].id = id;
+     finished[i].pgid = pgid;
+     finished[i].status = status;
+ }
+ 
+ /**
+  * @brief Removes the `n`th oldest kept status and returns it.
+  */
+ static int takeFinished(int n) {
+     int status = finished[(finishedStart + n) % FINISHED_MAX].status;
+     for (int i = n; i < finishedCount - 1; i++) {
+         finished[(finishedStart + i) % FINISHED_MAX] = finished[(finishedStart + i + 1) % FINISHED_MAX];
+     }
+     finishedCount--;
+     return status;
+ }
+ 
+ /**
+  * @brief Finds the kept status for `%n` or a job's pid, or `-1`.
+  */
+ static int findFinished(const char *spec) {
+     int id = spec[0] == '%' ? atoi(spec + 1) : 0;
+     pid_t pgid = spec[0] == '%' ? 0 : atoi(spec);
+     for (int n = 0; n < finishedCount; n++) {
+         int i = (finishedStart + n) % FINISHED_MAX;
+         if ((id && finished[i].id == id) || (pgid && finished[i].pgid == pgid)) return n;
+     }
+     return -1;
+ }
+ 
+ /**
+  * @brief Updates the job table for one `wait4()` result.
+  *
+  * When the last stage of a job is reaped, the job is removed and its
+  * pipeline status is either queued as a notification and kept for `wait`
+  * or, if `finalStatus` is given, stored there instead. Stops are always queued. Continues only
+  * change the job state. Each change is also logged (see eventlog.c).
+  *
+  * @param usage Resource usage of the reaped process (`NULL` if unknown).
+  * @return `1` if this result completed a job, `0` otherwise.
+  */
+ int jobRecordStatus(pid_t pid, int status, const struct rusage *usage, int *finalStatus) {
+     struct job *job = jobFind(pid);
+     if (!job) return 0;
+ 
+     if (WIFSTOPPED(status)) {
+         if (job->state != JOB_STOPPED) {
+             queueNotice(job->pgid, status);
+             eventLogJob("stop", job, status);
+         }
+         job->state = JOB_STOPPED;
+         return 0;
+     } else if (WIFCONTINUED(status)) {
+         if (job->state != JOB_RUNNING) eventLogJob("continue", job, status);
+         job->state = JOB_RUNNING;
+         return 0;
+     }
+ 
+     if (usage) {
+         job->usage.ru_utime.tv_sec += usage->ru_utime.tv_sec;
+         job->usage.ru_utime.tv_usec += usage->ru_utime.tv_usec;
+         job->usage.ru_stime.tv_sec += usage->ru_stime.tv_sec;
+         job->usage.ru_stime.tv_usec += usage->ru_stime.tv_usec;
+         if (usage->ru_maxrss > job->usage.ru_maxrss) job->usage.ru_maxrss = usage->ru_maxrss;
+     }
+     for (int i = 0; i < job->procCount; i++) {
+         if (job->pids[i] != pid) continue;
+         job->statuses[i] = status;
+         job->pids[i] = 0;
+         pidIndexRemove(pid);
+         job->liveCount--;
+     }
+     if (job->liveCount > 0) return 0;
+ 
+     int jobStatus = pipelineStatus(job->statuses, job->procCount);
+     eventLogJob(WIFSIGNALED(jobStatus) ? "signal" : "exit", job, jobStatus);
+     if (finalStatus) {
+         *finalStatus = jobStatus;
+     } else {
+         queueNotice(job->pgid, jobStatus);
+         rememberFinished(job->id, job->pgid, jobStatus);
+     }
+     jobRemove(job);
+     return 1;
+ }
+ 
+ /**
+  * @brief Prints queued job notifications with a single flush.
+  */
+ static void printNotifications() {
+     FILE *out = noticeOutput();
+     for (int i = 0; i < noticeCount; i++) {
+         int status = notices[i].status;
+         if (WIFSTOPPED(status)) {
+             fprintf(out, "background pid %d is stopped by signal %d\n", notices[i].pid, WSTOPSIG(status));
+             continue;
+         }
+         fprintf(out, "background pid %d is done: ", notices[i].pid);
+         if (WIFEXITED(status)) {
+             fprintf(out, "exit value %d\n", WEXITSTATUS(status));
+         } else {
+             fprintf(out, "terminated by signal %d\n", WTERMSIG(status));
+         }
+     }
+     if (noticeCount > 0) flushOutput();
+     noticeCount = 0;
+ }
+ 
+ /**
+  * @brief Reaps completed background processes and reports them.
+  *
+  * Called by the event loop (events.c) when SIGCHLD arrives. Reaps every
+  * changed child with `wait4(-1, WNOHANG)`, updates the job table and
+  * prints the queued notifications together, then writes out the event log.
+  *
+  * @param atPrompt Start the notifications on a new line, past the prompt.
+  * @return Number of notifications printed.
+  */
+ int checkBackgroundProcesses(int atPrompt) {
+     int status;
+     pid_t pid;
+     struct rusage usage;
+ 
+     while ((pid = wait4(-1, &status, WNOHANG | WUNTRACED | WCONTINUED, &usage)) > 0) {
+         jobRecordStatus(pid, status, &usage, NULL);
+     }
+     int printed = noticeCount;
+     if (printed > 0 && atPrompt) putchar('\n');
+     printNotifications();
+     eventLogFlush();
+     return printed;
+ }
+ 
+ /**
+  * @brief Puts the shell in its own process group in the foreground of its terminal.
+  *
+  * Called at startup by an interactive shell. If the shell was started in
+  * the background it waits (stopped by SIGTTIN) until it is brought to the
+  * foreground. SIGTTOU stays blocked so the shell can call `tcsetpgrp()`
+  * while a job owns the terminal.
+  */
+ void jobControlInit() {
+     pid_t pgrp;
+     while ((pgrp = tcgetpgrp(STDIN_FILENO)) != -1 && pgrp != getpgrp()) kill(-getpgrp(), SIGTTIN);
+     if (pgrp == -1) return; // No controlling terminal: no job control
+ 
+     sigset_t ttou;
+     sigemptyset(&ttou);
+     sigaddset(&ttou, SIGTTOU);
+     sigprocmask(SIG_BLOCK, &ttou, NULL);
+ 
+     if (getpgrp() != getpid()) setpgid(0, 0); // Fails harmlessly for a session leader
+     shellPgid = getpgrp();
+     tcsetpgrp(STDIN_FILENO, shellPgid);
+     tcgetattr(STDIN_FILENO, &shellModes);
+     jobControl = 1;
+ }
+ 
+ /**
+  * @brief Makes `pgid` the terminal's foreground process group (`0` for the shell).
+  *
+  * Taking the terminal back also restores the shell's terminal modes, in
+  * case a stopped job left them changed. Does nothing without job control.
+  */
+ void giveTerminal(pid_t pgid) {
+     if (!jobControl) return;
+     tcsetpgrp(STDIN_FILENO, pgid ? pgid : shellPgid);
+     if (!pgid) tcsetattr(STDIN_FILENO, TCSADRAIN, &shellModes);
+ }
+ 
+ /**
+  * @brief Sends `signo` to the process group of every job (used by `exit`).
+  */
+ void signalAllJobs(int signo) {
+     for (int i = 0; i < slotCap; i++) {
+         if (!slots[i].inUse) continue;
+         kill(-slots[i].pgid, signo);
+         if (slots[i].state == JOB_STOPPED) kill(-slots[i].pgid, SIGCONT);
+     }
+ }
+ 
+ /**
+  * @brief Finds the job named by `%n` or one of its pids, or `NULL`.
+  */
+ static struct job *findJob(const char *spec) {
+     return spec[0] == '%' ? jobGet(atoi(spec + 1)) : jobFind(atoi(spec));
+ }
+ 
+ /**
+  * @brief Resolves a job argument: `%n`, a pid, or (if `NULL`) the newest job.
+  *
+  * Prints an error naming `builtin` when nothing matches.
+  */
+ static struct job *parseJobSpec(const char *builtin, const char *spec) {
+     struct job *job = NULL;
+ 
+     if (!spec) {
+         for (int i = 0; i < slotCap; i++) {
+             if (!slots[i].inUse) continue;
+             if (!job || slots[i].start.tv_sec > job->start.tv_sec
+                 || (slots[i].start.tv_sec == job->start.tv_sec && slots[i].start.tv_nsec > job->start.tv_nsec)) {
+                 job = &slots[i];
+             }
+         }
+         if (!job) fprintf(stderr, "%s: no current job\n", builtin);
+         return job;
+     }
+ 
+     job = findJob(spec);
+     if (!job) fprintf(stderr, "%s: %s: no such job\n", builtin, spec);
+     return job;
+ }
+ 
+ /**
+  * @brief Converts a wait status to the value `status` reports: exit value or signal number.
+  */
+ static int statusValue(int status) {
+     if (WIFEXITED(status)) return WEXITSTATUS(status);
+     if (WIFSTOPPED(status)) return WSTOPSIG(status);
+     return WTERMSIG(status);
+ }
+ 
+ /**
+  * @brief Waits in the foreground until job `id` finishes or stops.
+  *
+  * @param id Job number.
+  * @param finalStatus Set to the job's pipeline status if it finished.
+  * @return `1` if the job finished, `0` if it stopped or could not be waited for.
+  */
+ static int waitForJob(int id, int *finalStatus) {
+     struct job *job = jobGet(id);
+     pid_t pgid = job->pgid;
+     int status;
+     pid_t pid;
+     struct rusage usage;
+ 
+     while ((pid = waitChild(-pgid, &status, WUNTRACED, &usage)) > 0) {
+         if (jobRecordStatus(pid, status, &usage, finalStatus)) return 1;
+         if (WIFSTOPPED(status)) return 0;
+     }
+     return 0;
+ }
+ 
+ /**
+  * @brief Built-in `jobs [-l]`: lists jobs with state, pid, run time and command.
+  *
+  * `-l` adds the placement from `set spread` (`cpu=N`, `node=N` or `-`).
+  */
+ int jobsBuiltin(char *args[]) {
+     struct timespec now;
+     int placement = args[1] && strcmp(args[1], "-l") == 0;
+     clock_gettime(CLOCK_MONOTONIC, &now);
+ 
+     for (int i = 0; i < slotCap; i++) {
+         struct job *job = &slots[i];
+         if (!job->inUse) continue;
+         long secs = now.tv_sec - job->start.tv_sec - (now.tv_nsec < job->start.tv_nsec);
+         printf("[%d] %-8s %d %ld:%02ld ", job->id,
+                job->state == JOB_STOPPED ? "Stopped" : "Running",
+                job->pgid, secs / 60, secs % 60);
+         if (placement) {
+             char where[24] = "-";
+             if (job->placedNode != -1) snprintf(where, sizeof where, "node=%d", job->placedNode);
+             else if (job->placedCPU != -1) snprintf(where, sizeof where, "cpu=%d", job->placedCPU);
+             printf("%-8s ", where);
+         }
+         printf("%s\n", job->command);
+     }
+     flushOutput();
+     return 0;
+ }
+ 
+ /**
+  * @brief Built-in `fg [%n|pid]`: continues a job and waits for it in the foreground.
+  */
+ int fgBuiltin(char *args[]) {
+     struct job *job = parseJobSpec("fg", args[1]);
+     int status;
+ 
+     if (!job) return 1;
+     printf("%s\n", job->command);
+     flushOutput();
+     giveTerminal(job->pgid);
+     if (job->state == JOB_STOPPED) kill(-job->pgid, SIGCONT);
+     job->state = JOB_RUNNING;
+ 
+     int done = waitForJob(job->id, &status);
+     giveTerminal(0);
+     if (!done) {
+         printNotifications();
+         return 1;
+     }
+     if (WIFEXITED(status)) {
+         lastExitStatus = WEXITSTATUS(status);
+     } else {
+         printf("terminated by signal %d\n", WTERMSIG(status));
+         flushOutput();
+         lastExitStatus = WTERMSIG(status);
+     }
+     return lastExitStatus;
+ }
+ 
+ /**
+  * @brief Built-in `bg [%n|pid]`: resumes a stopped job in the background.
+  */
+ int bgBuiltin(char *args[]) {
+     struct job *job = parseJobSpec("bg", args[1]);
+ 
+     if (!job) return 1;
+     if (job->state == JOB_STOPPED) {
+         kill(-job->pgid, SIGCONT);
+         job->state = JOB_RUNNING;
+     }
+     printf("[%d] %s &\n", job->id, job->command);
+     flushOutput();
+     return 0;
+ }
+ 
+ /**
+  * @brief `wait -n [%n|pid ...]`: waits for the next of the given jobs, or of any job, to finish.
+  *
+  * A job that already finished unwaited counts first, oldest first. The
+  * shell blocks in `wait4()` until a wanted job completes; other jobs
+  * finishing meanwhile are queued for a later `wait`.
+  *
+  * @return The job's status value, or `127` if there is nothing to wait for.
+  */
+ static int waitNext(char *specs[]) {
+     int wanted[FINISHED_MAX], wantedCount = 0, result = 127;
+ 
+     if (!specs[0] && finishedCount > 0) return statusValue(takeFinished(0));
+     for (int i = 0; specs[i]; i++) {
+         struct job *job = findJob(specs[i]);
+         int n;
+         if (job && wantedCount < FINISHED_MAX) wanted[wantedCount++] = job->id;
+         else if (!job && (n = findFinished(specs[i])) != -1) return statusValue(takeFinished(n));
+     }
+     if (specs[0] && wantedCount == 0) return 127;
+ 
+     int status;
+     pid_t pid;
+     struct rusage usage;
+     for (;;) {
+         int running = 0;
+         for (int i = 0; i < slotCap && !running; i++) {
+             if (!slots[i].inUse || slots[i].state != JOB_RUNNING || slots[i].parallel) continue;
+             running = wantedCount == 0;
+             for (int w = 0; w < wantedCount; w++) running |= wanted[w] == slots[i].id;
+         }
+         if (!running || (pid = waitChild(-1, &status, WUNTRACED, &usage)) <= 0) break;
+ 
+         struct job *job = jobFind(pid);
+         if (!job) continue;
+         int id = job->id, want = wantedCount == 0, jobStatus;
+         pid_t pgid = job->pgid;
+         for (int w = 0; w < wantedCount; w++) want |= wanted[w] == id;
+         if (!jobRecordStatus(pid, status, &usage, &jobStatus)) continue;
+         queueNotice(pgid, jobStatus);
+         if (want) {
+             result = statusValue(jobStatus);
+             break;
+         }
+         rememberFinished(id, pgid, jobStatus);
+     }
+     printNotifications();
+     return result;
+ }
+ 
+ /**
+  * @brief Built-in `wait [-n] [%n|pid ...]`: waits for the given jobs, or all running jobs.
+  *
+  * Completion notices are printed as usual. Returns the status of the last
+  * job waited for; a job that already finished gives its kept status.
+  * With `-n`, returns as soon as one job finishes (see `waitNext()`).
+  */
+ int waitBuiltin(char *args[]) {
+     int status, result = 0;
+     pid_t pid;
+ 
+     if (args[1] && strcmp(args[1], "-n") == 0) return waitNext(args + 2);
+     if (!args[1]) {
+         int running = 0;
+         for (int i = 0; i < slotCap; i++) {
+             if (slots[i].inUse && slots[i].state == JOB_RUNNING) running++;
+         }
+         struct rusage usage;
+         while (running > 0 && (pid = waitChild(-1, &status, WUNTRACED, &usage)) > 0) {
+             struct job *job = jobFind(pid);
+             if (!job) continue;
+             int wasRunning = job->state == JOB_RUNNING;
+             pid_t pgid = job->pgid;
+             int jobStatus;
+             if (jobRecordStatus(pid, status, &usage, &jobStatus)) {
+                 queueNotice(pgid, jobStatus);
+                 result = statusValue(jobStatus);
+                 running -= wasRunning;
+             } else if (WIFSTOPPED(status)) {
+                 running -= wasRunning;
+             }
+         }
+         finishedCount = 0; // Everything has been waited for
+         printNotifications();
+         return result;
+     }
+ 
+     for (int i = 1; args[i]; i++) {
+         int n;
+         if (!findJob(args[i]) && (n = findFinished(args[i])) != -1) {
+             result = statusValue(takeFinished(n));
+             continue;
+         }
+         struct job *job = parseJobSpec("wait", args[i]);
+         if (!job) {
+             result = 127;
+             continue;
+         }
+         if (job->state == JOB_STOPPED) continue;
+         pid_t pgid = job->pgid;
+         if (waitForJob(job->id, &status)) {
+             queueNotice(pgid, status);
+             result = statusValue(status);
+         }
+     }
+     printNotifications();
+     return result;
+ }
+ 
+ static const struct { const char *name; int signo; } signalNames[] = {
+     { "HUP", SIGHUP }, { "INT", SIGINT }, { "QUIT", SIGQUIT }, { "KILL", SIGKILL },
+     { "USR1", SIGUSR1 }, { "USR2", SIGUSR2 }, { "PIPE", SIGPIPE }, { "ALRM", SIGALRM },
+     { "TERM", SIGTERM }, { "CHLD", SIGCHLD }, { "CONT", SIGCONT }, { "STOP", SIGSTOP },
+     { "TSTP", SIGTSTP }, { "TTIN", SIGTTIN }, { "TTOU", SIGTTOU }, { "WINCH", SIGWINCH },
+ };
+ static const int signalNameCount = sizeof signalNames / sizeof signalNames[0];
+ 
+ /**
+  * @brief Parses a signal given as a number, `NAME` or `SIGNAME`.
+  *
+  * @return Signal number, or `-1` if unknown.
+  */
+ static int parseSignal(const char *text) {
+     char *end;
+     long signo = strtol(text, &end, 10);
+     if (end != text && *end == '\0') return signo >= 0 && signo < NSIG ? signo : -1;
+     if (strncmp(text, "SIG", 3) == 0) text += 3;
+     for (int i = 0; i < signalNameCount; i++) {
+         if (strcmp(text, signalNames[i].name) == 0) return signalNames[i].signo;
+     }
+     return -1;
+ }
+ 
+ /**
+  * @brief Built-in `kill [-s SIG | -SIG] %n|pid ...` and `kill -l`.
+  *
+  * A `%n` job spec signals the job's whole process group with one
+  * `kill(-pgid)`. A stopped job that is sent a terminating signal is also
+  * continued so it can act on it.
+  */
+ int killBuiltin(char *args[]) {
+     int signo = SIGTERM, i = 1, result = 0;
+ 
+     if (args[1] && strcmp(args[1], "-l") == 0) {
+         for (int j = 0; j < signalNameCount; j++) printf("%2d) SIG%s\n", signalNames[j].signo, signalNames[j].name);
+         flushOutput();
+         return 0;
+     }
+     if (args[i] && args[i][0] == '-') {
+         const char *name = strcmp(args[i], "-s") == 0 ? args[++i] : args[i] + 1;
+         if (!name || (signo = parseSignal(name)) == -1) {
+             fprintf(stderr, "kill: %s: invalid signal specification\n", name ? name : "-s");
+             return 1;
+         }
+         i++;
+     }
+     if (!args[i]) {
+         fprintf(stderr, "kill: usage: kill [-s SIG | -SIG] %%n|pid ... or kill -l\n");
+         return 1;
+     }
+ 
+     for (; args[i]; i++) {
+         pid_t target;
+         struct job *job = NULL;
+         if (args[i][0] == '%') {
+             if (!(job = parseJobSpec("kill", args[i]))) {
+                 result = 1;
+                 continue;
+             }
+             target = -job->pgid;
+         } else {
+             target = atoi(args[i]);
+             if (target <= 0) {
+                 fprintf(stderr, "kill: %s: arguments must be job specs or process IDs\n", args[i]);
+                 result = 1;
+                 continue;
+             }
+         }
+         if (kill(target, signo) == -1) {
+             fprintf(stderr, "kill: %s: %s\n", args[i], strerror(errno));
+             result = 1;
+             continue;
+         }
+         if (job && job->state == JOB_STOPPED && signo != SIGSTOP && signo != SIGTSTP && signo != SIGCONT) {
+             kill(target, SIGCONT);
+         }
+     }
+     return result;
+ }
@@ -0,0 +1,652 @@
+/**
+ * @file launch.c
+ * @brief Command launching for smallsh.
+ *
+ * Runs pipelines of external commands. Every stage goes through one of
+ * two launch engines: `posix_spawn` (the default) or `fork()` + `exec`.
+ * The shell opens redirection targets and pipe ends itself, close-on-exec,
+ * and each engine moves them onto the child's stdin/stdout.
+ */
+
+ #include "smallsh.h"
+ #include <limits.h>
+ #include <sys/mman.h>
+ 
+ /**
+  * @brief Starts a command with `posix_spawn()`.
+  *
+  * glibc implements `posix_spawn` with `CLONE_VM | CLONE_VFORK`, so the
+  * shell's page tables are never copied. Redirections become `dup2` file
+  * actions and the child's signal state is set through spawn attributes.
+  *
+  * @param args Array of command arguments (null-terminated).
+  * @param path Hashed absolute path of `args[0]` (`NULL` to search `$PATH`).
+  * @param background Flag for background execution.
+  * @param inputFD Descriptor to use as stdin (`-1` to inherit).
+  * @param outputFD Descriptor to use as stdout (`-1` to inherit).
+  * @param errorFD Descriptor to use as stderr (`-1` to inherit), applied after stdout.
+  * @param pgid Process group to join: `-1` inherits the shell's, `0` starts a new one.
+  * @return Child pid, or `-1` with `errno` set if the command could not be started.
+  */
+ static pid_t spawnCommand(char *args[], const char *path, int background, int inputFD, int outputFD, int errorFD,
+                          pid_t pgid) {
+     posix_spawn_file_actions_t actions;
+     posix_spawnattr_t attr;
+     sigset_t defaults, childMask, blockSignals, savedMask;
+     short flags = POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETSIGMASK;
+     pid_t spawnPid;
+ 
+     posix_spawn_file_actions_init(&actions);
+ #if __GLIBC_PREREQ(2, 35)
+     // A new foreground job takes the terminal before exec, so it cannot read
+     // the terminal (and stop on SIGTTIN) before the parent hands it over
+     if (jobControl && !background && pgid == 0) posix_spawn_file_actions_addtcsetpgrp_np(&actions, STDIN_FILENO);
+ #endif
+     if (inputFD != -1) posix_spawn_file_actions_adddup2(&actions, inputFD, STDIN_FILENO);
+     if (outputFD != -1) posix_spawn_file_actions_adddup2(&actions, outputFD, STDOUT_FILENO);
+     if (errorFD != -1) posix_spawn_file_actions_adddup2(&actions, errorFD, STDERR_FILENO);
+ 
+     posix_spawnattr_init(&attr);
+     sigemptyset(&defaults);
+     if (!background) sigaddset(&defaults, SIGINT); // Allow Ctrl+C in foreground
+     sigemptyset(&childMask);
+     posix_spawnattr_setsigdefault(&attr, &defaults);
+     posix_spawnattr_setsigmask(&attr, &childMask);
+     if (pgid != -1) {
+         posix_spawnattr_setpgroup(&attr, pgid);
+         flags |= POSIX_SPAWN_SETPGROUP;
+     }
+     posix_spawnattr_setflags(&attr, flags);
+ 
+     // Spawn attributes can only reset signals to default, so the child gets
+     // SIG_IGN for SIGTSTP (without job control) and SIGINT (in the background)
+     // by inheriting it. The shell keeps both blocked for its signalfd, so
+     // nothing is delivered while they are ignored here; one arriving in this
+     // window is dropped.
+     struct sigaction ignoreAction = {0}, savedTSTP, savedINT;
+     int ignoreTSTP = !jobControl;
+     ignoreAction.sa_handler = SIG_IGN;
+     sigemptyset(&blockSignals);
+     sigaddset(&blockSignals, SIGTSTP);
+     sigaddset(&blockSignals, SIGINT);
+     sigprocmask(SIG_BLOCK, &blockSignals, &savedMask);
+     if (ignoreTSTP) sigaction(SIGTSTP, &ignoreAction, &savedTSTP);
+     if (background) sigaction(SIGINT, &ignoreAction, &savedINT);
+ 
+     int err;
+     if (path) {
+         err = posix_spawn(&spawnPid, path, &actions, &attr, args, environ);
+         if (err != 0) {
+             hashForget(args[0]); // Stale entry: fall back to a full search
+             path = NULL;
+         }
+     }
+     if (!path) {
+         err = posix_spawnp(&spawnPid, args[0], &actions, &attr, args, environ);
+     }
+ 
+     if (ignoreTSTP) sigaction(SIGTSTP, &savedTSTP, NULL);
+     if (background) sigaction(SIGINT, &savedINT, NULL);
+     sigprocmask(SIG_SETMASK, &savedMask, NULL);
+     posix_spawnattr_destroy(&attr);
+     posix_spawn_file_actions_destroy(&actions);
+ 
+     if (err != 0) {
+         errno = err;
+         return -1;
+     }
+     return spawnPid;
+ }
+ 
+ /**
+  * @brief Turns the calling process into the command; returns only on bad limits.
+  *
+  * Shared by forked children and `execInPlace()`: installs the stage's
+  * descriptors and the child signal state, applies `limits`, then execs.
+  *
+  * @param args Command and arguments, `NULL`-terminated.
+  * @param path Hashed executable path, or `NULL` to search `$PATH`.
+  * @param background Flag for background signal handling.
+  * @param inputFD Descriptor for stdin (`-1` to inherit).
+  * @param outputFD Descriptor for stdout (`-1` to inherit).
+  * @param errorFD Descriptor for stderr (`-1` to inherit).
+  * @param execStamp Shared memory stamped just before exec (`NULL` for none).
+  * @param limits Limits applied before exec (`NULL` for none).
+  */
+ static void execChild(char *args[], const char *path, int background, int inputFD, int outputFD, int errorFD,
+                       struct timespec *execStamp, const struct launchLimits *limits) {
+     if (inputFD != -1) dup2(inputFD, STDIN_FILENO);
+     if (outputFD != -1) dup2(outputFD, STDOUT_FILENO);
+     if (errorFD != -1) dup2(errorFD, STDERR_FILENO);
+ 
+     // Set signal handling
+     struct sigaction ignoreAction = {0};
+     ignoreAction.sa_handler = SIG_IGN;
+     if (!jobControl) sigaction(SIGTSTP, &ignoreAction, NULL); // Ignore Ctrl+Z unless it stops the job
+ 
+     if (background) {
+         sigaction(SIGINT, &ignoreAction, NULL); // Background jobs ignore Ctrl+C
+     } else {
+         struct sigaction defaultAction = {0};
+         defaultAction.sa_handler = SIG_DFL;
+         sigaction(SIGINT, &defaultAction, NULL); // Allow Ctrl+C in foreground
+     }
+     sigset_t childMask;
+     sigemptyset(&childMask);
+     sigprocmask(SIG_SETMASK, &childMask, NULL); // Undo the shell's signalfd blocking
+ 
+     if (limits && applyLimits(limits) == -1) return;
+ 
+     // Execute the command, searching $PATH only if the hashed path fails
+     if (execStamp) clock_gettime(CLOCK_MONOTONIC, execStamp);
+     if (path) execv(path, args);
+     execvp(args[0], args);
+     perror("command not found");
+     exit(1);
+ }
+ 
+ /**
+  * @brief Starts a command with `fork()` and `execvp()`.
+  *
+  * Fallback engine, selected with `SMALLSH_LAUNCH=fork`. Takes the same
+  * parameters as `spawnCommand()`, plus the same handling of a stale
+  * hashed path: it is checked with `access()` here, as the child's fallback
+  * to `execvp()` could not report it back. Also takes:
+  *
+  * @param execStamp Shared memory the child stamps just before exec (`NULL` for none).
+  * @param limits Limits the child applies to itself before exec (`NULL` for none).
+  * @return Child pid, or `-1` if `fork()` failed.
+  */
+ static pid_t forkCommand(char *args[], const char *path, int background, int inputFD, int outputFD, int errorFD,
+                          pid_t pgid, struct timespec *execStamp, const struct launchLimits *limits) {
+     if (path && access(path, X_OK) == -1) {
+         hashForget(args[0]); // Stale entry: the child searches $PATH instead
+         path = NULL;
+     }
+     pid_t spawnPid = fork();
+ 
+     if (spawnPid > 0 && pgid != -1) setpgid(spawnPid, pgid); // Also set here to avoid racing the child
+     if (spawnPid != 0) return spawnPid; // Parent process (or fork failure)
+ 
+     // Child process
+     if (pgid != -1) setpgid(0, pgid);
+     if (jobControl && !background && pgid != -1) tcsetpgrp(STDIN_FILENO, getpgrp()); // SIGTTOU is still blocked
+     execChild(args, path, background, inputFD, outputFD, errorFD, execStamp, limits);
+     exit(1);
+ }
+ 
+ /**
+  * @brief Opens an output redirection target.
+  *
+  * `REDIR_PREALLOC` also reserves `set prealloc=SIZE` bytes with
+  * `fallocate(FALLOC_FL_KEEP_SIZE)`, so a large sequential write lands in
+  * few extents. The file size is unchanged; filesystems without
+  * `fallocate` just skip it.
+  *
+  * @param path File to open.
+  * @param mode `REDIR_TRUNCATE`, `REDIR_APPEND` or `REDIR_PREALLOC`.
+  * @return Close-on-exec descriptor, or `-1` with `errno` set.
+  */
+ int openOutput(const char *path, int mode) {
+     int flags = O_WRONLY | O_CREAT | O_CLOEXEC | (mode == REDIR_APPEND ? O_APPEND : O_TRUNC);
+     int fd = open(path, flags, 0644);
+     if (fd != -1 && mode == REDIR_PREALLOC && preallocBytes > 0) {
+         fallocate(fd, FALLOC_FL_KEEP_SIZE, 0, preallocBytes); // Best effort
+     }
+     return fd;
+ }
+ 
+ /**
+  * @brief Opens a stage's input: its `<` file or its here-doc/here-string text.
+  *
+  * Text that fits in a pipe's atomic write size is written into a pipe;
+  * anything larger goes into a `memfd`, rewound to the start. Either way
+  * it is served from memory.
+  *
+  * @return Close-on-exec descriptor, or `-1` with `errno` set.
+  */
+ int openInput(struct command *cmd) {
+     if (!cmd->inputText) return open(cmd->inputFile, O_RDONLY | O_CLOEXEC);
+ 
+     int fd, ends[2];
+     if (cmd->inputLen <= PIPE_BUF && pipe2(ends, O_CLOEXEC) == 0) {
+         write(ends[1], cmd->inputText, cmd->inputLen); // Fits in the pipe buffer: never blocks
+         close(ends[1]);
+         return ends[0];
+     }
+ 
+     fd = memfd_create("smallsh-heredoc", MFD_CLOEXEC);
+     if (fd == -1) return -1;
+     for (size_t done = 0; done < cmd->inputLen; ) {
+         ssize_t n = write(fd, cmd->inputText + done, cmd->inputLen - done);
+         if (n == -1) {
+             close(fd);
+             return -1;
+         }
+         done += n;
+     }
+     lseek(fd, 0, SEEK_SET);
+     return fd;
+ }
+ 
+ /**
+  * @brief Opens a command's `<`, `>` and `2>` targets.
+  *
+  * @param cmd Command whose redirections to open.
+  * @param files Receives the input, output and error descriptors (`-1` where none).
+  * @return `0`, or `-1` after printing why and closing what was opened.
+  */
+ static int openRedirections(struct command *cmd, int files[3]) {
+     files[0] = files[1] = files[2] = -1;
+ 
+     // Handle input redirection
+     if (cmd->inputFile || cmd->inputText) {
+         files[0] = openInput(cmd);
+         if (files[0] == -1) {
+             perror("cannot open input file");
+             return -1;
+         }
+     }
+ 
+     // Handle output redirection
+     if (cmd->outputFile) {
+         files[1] = openOutput(cmd->outputFile, cmd->outputMode);
+         if (files[1] == -1) {
+             perror("cannot open output file");
+             if (files[0] != -1) close(files[0]);
+             return -1;
+         }
+     }
+ 
+     // Handle error redirection
+     if (cmd->errorFile) {
+         files[2] = openOutput(cmd->errorFile, cmd->errorMode);
+         if (files[2] == -1) {
+             perror("cannot open error file");
+             if (files[0] != -1) close(files[0]);
+             if (files[1] != -1) close(files[1]);
+             return -1;
+         }
+     }
+     return 0;
+ }
+ 
+ /**
+  * @brief Applies a command's redirections to the shell itself, for an in-process utility.
+  *
+  * The descriptors being replaced are kept in `saved` for `restoreRedirections()`.
+  *
+  * @param saved Set to the copy of each of stdin, stdout and stderr that was
+  *              replaced, `-1` where nothing changed.
+  * @return `0`, or `-1` after printing why a target could not be opened.
+  */
+ int applyRedirections(struct command *cmd, int saved[3]) {
+     int files[3];
+     saved[0] = saved[1] = saved[2] = -1;
+     if (openRedirections(cmd, files) == -1) return -1;
+     if (files[2] == -1 && cmd->errorToOutput) { // `2>&1`: stderr follows the new stdout
+         files[2] = fcntl(files[1] != -1 ? files[1] : STDOUT_FILENO, F_DUPFD_CLOEXEC, 10);
+     }
+ 
+     fflush(stdout); // Earlier output belongs to the old stdout
+     for (int i = 0; i < 3; i++) {
+         if (files[i] == -1) continue;
+         saved[i] = fcntl(i, F_DUPFD_CLOEXEC, 10);
+         dup2(files[i], i);
+         close(files[i]);
+     }
+     return 0;
+ }
+ 
+ /**
+  * @brief Puts back the descriptors replaced by `applyRedirections()`.
+  */
+ void restoreRedirections(int saved[3]) {
+     fflush(stdout);
+     fflush(stderr);
+     for (int i = 0; i < 3; i++) {
+         if (saved[i] == -1) continue;
+         dup2(saved[i], i);
+         close(saved[i]);
+     }
+ }
+ 
+ /**
+  * @brief Launches one pipeline stage.
+  *
+  * Opens the stage's redirection targets, which take precedence over the
+  * pipe ends passed in, and starts it with the configured engine.
+  *
+  * @param cmd Stage to run.
+  * @param background Flag for background execution.
+  * @param inputFD Pipe end for stdin (`-1` to inherit).
+  * @param outputFD Pipe end for stdout (`-1` to inherit).
+  * @param errorFD Descriptor for stderr (`-1` to inherit); replaced by a `2>` file or `2>&1`.
+  * @param pgid Process group to join (see `spawnCommand()`).
+  * @param execStamp Where a forked child stamps its exec time (`NULL` for none).
+  * @param placement CPUs and memory node from `set spread` (`NULL` for none).
+  * @return Child pid, `0` for a stage without words (nothing to run), or `-1`
+  *         after printing why the stage could not start.
+  */
+ static pid_t launchStage(struct command *cmd, int background, int inputFD, int outputFD, int errorFD,
+                          pid_t pgid, struct timespec *execStamp, const struct launchLimits *placement) {
+     int files[3];
+     pid_t spawnPid;
+ 
+     if (openRedirections(cmd, files) == -1) return -1;
+     if (!cmd->args[0]) { // Its words expanded to nothing: only the redirections happen
+         for (int i = 0; i < 3; i++) {
+             if (files[i] != -1) close(files[i]);
+         }
+         return 0;
+     }
+     if (files[0] != -1) inputFD = files[0];
+     if (files[1] != -1) outputFD = files[1];
+     if (files[2] != -1) errorFD = files[2];
+     else if (cmd->errorToOutput) errorFD = outputFD != -1 ? outputFD : STDOUT_FILENO;
+ 
+     // A `limit ... --` prefix and a placement are applied by the child itself,
+     // so they always fork. An explicit `limit cpu=` wins over the placement.
+     char **args = cmd->args;
+     struct launchLimits limits;
+     const struct launchLimits *childLimits = placement;
+     if (strcmp(args[0], "limit") == 0) {
+         args = parseLimits(args, &limits);
+         if (args && placement && !limits.hasCpus) {
+             limits.cpus = placement->cpus;
+             limits.hasCpus = placement->hasCpus;
+         }
+         if (args && placement && !limits.hasMemNode) {
+             limits.memNode = placement->memNode;
+             limits.hasMemNode = placement->hasMemNode;
+         }
+         childLimits = &limits;
+     }
+ 
+     const char *path = args ? hashLookup(args[0]) : NULL;
+     varSyncEnviron(); // Only rebuilds environ if an exported variable changed
+ 
+     if (!args) {
+         spawnPid = -1;
+     } else if (launchMode == LAUNCH_FORK || childLimits) {
+         spawnPid = forkCommand(args, path, background, inputFD, outputFD, errorFD, pgid, execStamp, childLimits);
+         if (spawnPid == -1) {
+             perror("fork() failed");
+             exit(1);
+         }
+     } else {
+         spawnPid = spawnCommand(args, path, background, inputFD, outputFD, errorFD, pgid);
+         if (spawnPid == -1) perror("command not found");
+     }
+ 
+     for (int i = 0; i < 3; i++) {
+         if (files[i] != -1) close(files[i]);
+     }
+     return spawnPid;
+ }
+ 
+ /**
+  * @brief Joins a command's arguments with spaces, for `jobs`.
+  *
+  * @return Newly allocated string.
+  */
+ char *joinArgs(char **args) {
+     size_t len = 1;
+     for (char **arg = args; *arg; arg++) len += strlen(*arg) + 1;
+ 
+     char *line = malloc(len), *p = line;
+     for (char **arg = args; *arg; arg++) {
+         if (arg != args) *p++ = ' ';
+         p = stpcpy(p, *arg);
+     }
+     *p = '\0';
+     return line;
+ }
+ 
+ /**
+  * @brief Starts one command without waiting for it, for builtin job runners.
+  *
+  * A foreground child stays in the shell's process group with foreground
+  * signal handling, so Ctrl+C reaches it. A background child gets its own
+  * process group and ignores SIGINT. The caller owns reaping it.
+  *
+  * @param cmd Command to run.
+  * @param background Flag for background execution.
+  * @param inputFD Descriptor to use as stdin (`-1` to inherit).
+  * @param outputFD Descriptor to use as stdout (`-1` to inherit).
+  * @param placement CPUs and memory node from `nextPlacement()` (`NULL` for none).
+  * @return Child pid, or `-1` after printing why it could not start.
+  */
+ pid_t launchCommand(struct command *cmd, int background, int inputFD, int outputFD,
+                     const struct launchLimits *placement) {
+     fflush(stdout); // Children write to the same stdout
+     syncInputBeforeLaunch();
+     return launchStage(cmd, background, inputFD, outputFD, -1, background ? 0 : -1, NULL, placement);
+ }
+ 
+ /**
+  * @brief Replaces the shell with a foreground command, for the end of `smallsh -c`.
+  *
+  * Nothing runs after it, so there is no child to wait for: the shell
+  * applies the redirections and any `limit` prefix to itself and execs,
+  * and the command's exit status becomes the shell's. `$PATH` is searched
+  * by `execvp()` directly rather than by building the hash table.
+  *
+  * @param cmd Command to become.
+  * @return Only if the command could not start: its exit status (`1`).
+  */
+ int execInPlace(struct command *cmd) {
+     int files[3];
+     if (openRedirections(cmd, files) == -1) return 1;
+ 
+     char **args = cmd->args;
+     struct launchLimits limits;
+     if (strcmp(args[0], "limit") == 0) {
+         args = parseLimits(args, &limits);
+         if (!args) return 1;
+     }
+ 
+     int errorFD = files[2];
+     if (errorFD == -1 && cmd->errorToOutput) errorFD = files[1] != -1 ? files[1] : STDOUT_FILENO;
+     fflush(stdout);
+     syncInputBeforeLaunch();
+     varSyncEnviron();
+     eventLogFlush();
+     execChild(args, NULL, 0, files[0], files[1], errorFD, NULL, args == cmd->args ? NULL : &limits);
+     for (int i = 0; i < 3; i++) {
+         if (files[i] != -1) close(files[i]);
+     }
+     return 1;
+ }
+ 
+ /**
+  * @brief Builds the command line shown by `jobs` for a pipeline.
+  *
+  * @return Newly allocated string.
+  */
+ char *formatPipeline(struct pipeline *pipeline) {
+     size_t len = 1;
+     for (int i = 0; i < pipeline->count; i++) {
+         for (char **arg = pipeline->stages[i].args; *arg; arg++) len += strlen(*arg) + 1;
+         len += 2;
+     }
+ 
+     char *line = malloc(len);
+     line[0] = '\0';
+     for (int i = 0; i < pipeline->count; i++) {
+         if (i > 0) strcat(line, " | ");
+         for (char **arg = pipeline->stages[i].args; *arg; arg++) {
+             if (arg != pipeline->stages[i].args) strcat(line, " ");
+             strcat(line, *arg);
+         }
+     }
+     return line;
+ }
+ 
+ /**
+  * @brief Picks the wait status that stands for a whole pipeline.
+  *
+  * That is the last stage's status, or with `set -o pipefail` the status
+  * of the rightmost stage that did not exit with 0.
+  *
+  * @param statuses Wait status of each stage.
+  * @param count Number of stages.
+  */
+ int pipelineStatus(const int *statuses, int count) {
+     if (pipefail) {
+         for (int i = count - 1; i >= 0; i--) {
+             if (!WIFEXITED(statuses[i]) || WEXITSTATUS(statuses[i]) != 0) return statuses[i];
+         }
+     }
+     return statuses[count - 1];
+ }
+ 
+ /**
+  * @brief Executes a pipeline with I/O redirection and background execution.
+  *
+  * Handles:
+  * - Pipes between stages (`|`), wired with `pipe2(O_CLOEXEC)`
+  * - Input redirection (`<`) and output redirection (`>`) per stage
+  * - Background execution (`&`): the stages share a new process group
+  *   whose leader is the first stage, and the pipeline becomes one job
+  * - Foreground execution with proper signal handling. With job control a
+  *   foreground pipeline also gets its own process group and the terminal;
+  *   if Ctrl+Z stops it, it is added to the job table as a stopped job
+  * - With `set -o tagoutput`, a background job's output and errors go
+  *   through a pipe the shell reads and tags (see tagout.c)
+  *
+  * `lastExitStatus` is set from the last stage (see `pipelineStatus()`).
+  * A stage that cannot be started counts as exit value 1. With `timing on`,
+  * foreground pipelines are timed and reported (see timing.c); one marked
+  * `timed` (the `time` keyword) has its real, CPU and peak memory figures
+  * reported. `timed` is cleared to show that the pipeline was handled here.
+  *
+  * @param pipeline Stages to run and whether to run them in the background.
+  */
+ void executeCommand(struct pipeline *pipeline) {
+     int count = pipeline->count;
+     int background = pipeline->background && !foregroundOnly;
+     pid_t pids[count];
+     int statuses[count];
+     pid_t leader = 0;
+     int prevRead = -1;
+     int report = pipeline->timed && !background;
+     int timed = (timingEnabled && !background) || report;
+     struct commandTiming timing = {0};
+     struct timespec start, now, stageStarts[count];
+     struct timespec *execStamps[count];
+     struct launchLimits placement;
+     int placedCPU = -1, placedNode = -1;
+     int placed = background && nextPlacement(&placement, &placedCPU, &placedNode);
+     int tagFDs[2] = {-1, -1}; // With `set -o tagoutput`, the job's output pipe
+     if (background && tagOutput && tagPipe(tagFDs) == -1) tagFDs[0] = tagFDs[1] = -1;
+ 
+     pipeline->timed = 0;
+     fflush(stdout); // Children write to the same stdout
+     syncInputBeforeLaunch();
+     if (timed) clock_gettime(CLOCK_MONOTONIC, &start);
+ 
+     for (int i = 0; i < count; i++) {
+         int pipeFDs[2] = {-1, -1};
+         struct timespec *execStamp = timed && launchMode == LAUNCH_FORK ? timingExecStamp(i) : NULL;
+         execStamps[i] = execStamp;
+ 
+         if (i < count - 1 && pipe2(pipeFDs, O_CLOEXEC) == -1) {
+             perror("pipe() failed");
+             pipeFDs[0] = pipeFDs[1] = -1;
+         }
+ 
+         pid_t pgid = background || jobControl ? leader : -1; // Jobs get their own group
+         if (timed) clock_gettime(CLOCK_MONOTONIC, &stageStarts[i]);
+         if (execStamp) execStamp->tv_sec = execStamp->tv_nsec = 0;
+         int outputFD = i < count - 1 ? pipeFDs[1] : tagFDs[1];
+         pids[i] = launchStage(&pipeline->stages[i], background, prevRead, outputFD, tagFDs[1], pgid, execStamp,
+                               placed ? &placement : NULL);
+         if (timed) {
+             // posix_spawn returns once the child has exec'd, so launch time is exec time
+             clock_gettime(CLOCK_MONOTONIC, &now);
+             double launchUs = elapsedUs(&stageStarts[i], &now);
+             timing.launchUs += launchUs;
+             if (!execStamp && launchUs > timing.execUs) timing.execUs = launchUs;
+         }
+         statuses[i] = pids[i] == 0 ? 0 : W_EXITCODE(1, 0);
+         if (pids[i] == -1) {
+             pids[i] = 0;
+         } else if (pids[i] > 0 && pgid == 0) {
+             leader = pids[i];
+             if (!background) giveTerminal(leader);
+         }
+ 
+         if (prevRead != -1) close(prevRead);
+         if (pipeFDs[1] != -1) close(pipeFDs[1]);
+         prevRead = pipeFDs[0];
+     }
+     if (tagFDs[1] != -1) close(tagFDs[1]);
+ 
+     if (background) {
+         if (leader == 0) { // Nothing started
+             if (tagFDs[0] != -1) close(tagFDs[0]);
+             return;
+         }
+         fprintf(noticeOutput(), "background pid is %d\n", leader);
+         flushOutput();
+         lastBackgroundPid = leader;
+         struct job *job = jobAdd(leader, pids, statuses, count, formatPipeline(pipeline));
+         job->placedCPU = placedCPU;
+         job->placedNode = placedNode;
+         if (tagFDs[0] != -1) tagStreamAdd(tagFDs[0], job->id);
+         return;
+     }
+ 
+     struct timespec waitStart;
+     struct rusage usage;
+     if (timed) clock_gettime(CLOCK_MONOTONIC, &waitStart);
+     int stopSignal = 0;
+     int untraced = jobControl && leader ? WUNTRACED : 0; // Only a job in its own group can be set aside
+     for (int i = 0; i < count; i++) {
+         if (pids[i] > 0 && waitChild(pids[i], &statuses[i], untraced, &usage) > 0) { // Wait for foreground process
+             if (WIFSTOPPED(statuses[i])) {
+                 stopSignal = WSTOPSIG(statuses[i]);
+                 break;
+             }
+             pids[i] = 0; // Reaped
+             timing.userUs += timevalUs(&usage.ru_utime);
+             timing.sysUs += timevalUs(&usage.ru_stime);
+             if (usage.ru_maxrss > timing.maxRssKB) timing.maxRssKB = usage.ru_maxrss;
+         }
+     }
+     giveTerminal(0);
+     if (stopSignal) {
+         // Ctrl+Z: the rest of the job becomes a stopped job for `fg`/`bg`
+         struct job *job = jobAdd(leader, pids, statuses, count, formatPipeline(pipeline));
+         job->state = JOB_STOPPED;
+         eventLogJob("stop", job, W_STOPCODE(stopSignal));
+         fprintf(noticeOutput(), "\nbackground pid %d is stopped by signal %d\n", leader, stopSignal);
+         flushOutput();
+         lastExitStatus = stopSignal;
+         syncInputAfterWait();
+         return;
+     }
+     syncInputAfterWait();
+     if (timed) {
+         clock_gettime(CLOCK_MONOTONIC, &now);
+         timing.waitUs = elapsedUs(&waitStart, &now);
+         timing.realUs = elapsedUs(&start, &now);
+         for (int i = 0; i < count; i++) { // Stamps left by forked children
+             if (!execStamps[i] || execStamps[i]->tv_sec == 0) continue;
+             double execUs = elapsedUs(&stageStarts[i], execStamps[i]);
+             if (execUs > timing.execUs) timing.execUs = execUs;
+         }
+         if (timingEnabled) timingRecord(&timing);
+         if (report) timeReport(&timing);
+     }
+ 
+     int childStatus = pipelineStatus(statuses, count);
+     if (WIFEXITED(childStatus)) {
+         lastExitStatus = WEXITSTATUS(childStatus);
+     } else {
+         fprintf(noticeOutput(), "terminated by signal %d\n", WTERMSIG(childStatus));
+         flushOutput();
+         lastExitStatus = WTERMSIG(childStatus);
+     }
+ }
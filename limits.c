@@ -0,0 +1,231 @@
+/**
+ * @file limits.c
+ * @brief Resource limits: the `ulimit` builtin and the `limit` command prefix.
+ *
+ *     ulimit [-H|-S] [-a | -c|-d|-f|-l|-n|-s|-t|-u|-v [value|unlimited]]
+ *     limit [mem=SIZE] [cpu=LIST] [nofile=N] [time=SECS] [cgroup=PATH] -- command...
+ *
+ * `ulimit` changes the shell's own limits, which every later child
+ * inherits. `limit` applies only to the command it prefixes. The launcher
+ * applies it in the forked child just before exec: cgroup v2 placement,
+ * CPU affinity, then `setrlimit()`. It works as a pipeline stage and under
+ * `par` too, e.g. `par -j4 limit cpu=0-3 -- cmd ::: ...`.
+ */
+
+ #include "smallsh.h"
+ #include <sys/resource.h>
+ 
+ static const struct {
+     char option;
+     int resource;
+     const char *name;
+     int unit;      // Bytes per displayed unit
+ } resources[] = {
+     { 'c', RLIMIT_CORE, "core file size (kbytes)", 1024 },
+     { 'd', RLIMIT_DATA, "data seg size (kbytes)", 1024 },
+     { 'f', RLIMIT_FSIZE, "file size (kbytes)", 1024 },
+     { 'l', RLIMIT_MEMLOCK, "max locked memory (kbytes)", 1024 },
+     { 'n', RLIMIT_NOFILE, "open files", 1 },
+     { 's', RLIMIT_STACK, "stack size (kbytes)", 1024 },
+     { 't', RLIMIT_CPU, "cpu time (seconds)", 1 },
+     { 'u', RLIMIT_NPROC, "max user processes", 1 },
+     { 'v', RLIMIT_AS, "virtual memory (kbytes)", 1024 },
+ };
+ static const int resourceCount = sizeof resources / sizeof resources[0];
+ 
+ /**
+  * @brief Prints one limit in `ulimit` units.
+  */
+ static void printLimit(rlim_t value, int unit) {
+     if (value == RLIM_INFINITY) printf("unlimited\n");
+     else printf("%llu\n", (unsigned long long)(value / unit));
+ }
+ 
+ /**
+  * @brief Built-in `ulimit`: shows or sets the shell's soft (`-S`) or hard (`-H`) limits.
+  *
+  * Setting without `-S` or `-H` sets both. With no resource option the
+  * file size limit (`-f`) is used.
+  */
+ int ulimitBuiltin(char *args[]) {
+     int hard = 0, soft = 0, all = 0, which = -1, i;
+ 
+     for (i = 1; args[i] && args[i][0] == '-' && args[i][1]; i++) {
+         for (const char *opt = args[i] + 1; *opt; opt++) {
+             if (*opt == 'H') hard = 1;
+             else if (*opt == 'S') soft = 1;
+             else if (*opt == 'a') all = 1;
+             else {
+                 which = -1;
+                 for (int r = 0; r < resourceCount; r++) {
+                     if (resources[r].option == *opt) which = r;
+                 }
+                 if (which == -1) {
+                     fprintf(stderr, "ulimit: -%c: invalid option\n", *opt);
+                     return 1;
+                 }
+             }
+         }
+     }
+     if (which == -1) which = 2; // -f
+ 
+     if (all) {
+         for (int r = 0; r < resourceCount; r++) {
+             struct rlimit rl;
+             getrlimit(resources[r].resource, &rl);
+             printf("%-28s(-%c) ", resources[r].name, resources[r].option);
+             printLimit(hard ? rl.rlim_max : rl.rlim_cur, resources[r].unit);
+         }
+         flushOutput();
+         return 0;
+     }
+ 
+     struct rlimit rl;
+     getrlimit(resources[which].resource, &rl);
+     if (!args[i]) {
+         printLimit(hard ? rl.rlim_max : rl.rlim_cur, resources[which].unit);
+         flushOutput();
+         return 0;
+     }
+ 
+     rlim_t value;
+     if (strcmp(args[i], "unlimited") == 0) {
+         value = RLIM_INFINITY;
+     } else {
+         char *end;
+         unsigned long long n = strtoull(args[i], &end, 10);
+         if (end == args[i] || *end != '\0') {
+             fprintf(stderr, "ulimit: %s: invalid number\n", args[i]);
+             return 1;
+         }
+         value = (rlim_t)n * resources[which].unit;
+     }
+     if (!hard && !soft) hard = soft = 1;
+     if (hard) rl.rlim_max = value;
+     if (soft) rl.rlim_cur = value;
+     if (setrlimit(resources[which].resource, &rl) == -1) {
+         fprintf(stderr, "ulimit: %s: %s\n", resources[which].name, strerror(errno));
+         return 1;
+     }
+     return 0;
+ }
+ 
+ /**
+  * @brief Parses a CPU list such as `0-3,6` into `set`.
+  *
+  * @return `0` on success, `-1` if the list is malformed.
+  */
+ int parseCPUList(const char *text, cpu_set_t *set) {
+     CPU_ZERO(set);
+     while (*text) {
+         char *end;
+         long first = strtol(text, &end, 10), last = first;
+         if (end == text || first < 0) return -1;
+         if (*end == '-') {
+             text = end + 1;
+             last = strtol(text, &end, 10);
+             if (end == text || last < first) return -1;
+         }
+         if (last >= CPU_SETSIZE) return -1;
+         for (long cpu = first; cpu <= last; cpu++) CPU_SET(cpu, set);
+         if (*end == ',') end++;
+         else if (*end) return -1;
+         text = end;
+     }
+     return 0;
+ }
+ 
+ /**
+  * @brief Parses a `limit key=value ... -- command` prefix.
+  *
+  * @param args Stage arguments, starting with "limit".
+  * @param limits Filled in with the requested limits.
+  * @return The command's arguments (after `--`), or `NULL` after printing an error.
+  */
+ char **parseLimits(char **args, struct launchLimits *limits) {
+     memset(limits, 0, sizeof *limits);
+     for (int i = 1; args[i]; i++) {
+         if (strcmp(args[i], "--") == 0) {
+             if (args[i + 1]) return &args[i + 1];
+             break;
+         }
+         char *value = strchr(args[i], '=');
+         if (!value) break;
+         size_t keyLen = value++ - args[i];
+ 
+         long long number = -1;
+         if (strncmp(args[i], "cpu", keyLen) == 0 && keyLen == 3) {
+             if (parseCPUList(value, &limits->cpus) == 0) {
+                 limits->hasCpus = 1;
+                 continue;
+             }
+         } else if (strncmp(args[i], "cgroup", keyLen) == 0 && keyLen == 6) {
+             limits->cgroup = value;
+             continue;
+         } else if (limits->rlimitCount < LIMIT_MAX) {
+             int resource = -1;
+             if (strncmp(args[i], "mem", keyLen) == 0 && keyLen == 3) {
+                 resource = RLIMIT_AS;
+                 number = parseSize(value);
+             } else if (strncmp(args[i], "nofile", keyLen) == 0 && keyLen == 6) {
+                 resource = RLIMIT_NOFILE;
+                 number = parseSize(value);
+             } else if (strncmp(args[i], "time", keyLen) == 0 && keyLen == 4) {
+                 resource = RLIMIT_CPU;
+                 number = parseSize(value);
+             } else {
+                 fprintf(stderr, "limit: %.*s: unknown limit\n", (int)keyLen, args[i]);
+                 return NULL;
+             }
+             if (number >= 0) {
+                 limits->resources[limits->rlimitCount] = resource;
+                 limits->values[limits->rlimitCount++] = number;
+                 continue;
+             }
+         }
+         fprintf(stderr, "limit: %s: invalid value\n", args[i]);
+         return NULL;
+     }
+     fprintf(stderr, "limit: usage: limit key=value... -- command...\n");
+     return NULL;
+ }
+ 
+ /**
+  * @brief Applies `limits` to the calling process (a forked child about to exec).
+  *
+  * @return `0` on success, `-1` after printing what failed.
+  */
+ int applyLimits(const struct launchLimits *limits) {
+     if (limits->cgroup) {
+         char path[4096];
+         snprintf(path, sizeof path, "%s%s/cgroup.procs",
+                  limits->cgroup[0] == '/' ? "" : "/sys/fs/cgroup/", limits->cgroup);
+         int fd = open(path, O_WRONLY | O_CLOEXEC);
+         char pid[16];
+         int len = snprintf(pid, sizeof pid, "%d", getpid());
+         if (fd == -1 || write(fd, pid, len) != len) {
+             perror(path);
+             return -1;
+         }
+         close(fd);
+     }
+     if (limits->hasCpus && sched_setaffinity(0, sizeof limits->cpus, &limits->cpus) == -1) {
+         perror("limit: cpu");
+         return -1;
+     }
+     if (limits->hasMemNode && preferMemoryNode(limits->memNode) == -1) {
+         perror("limit: set_mempolicy");
+         return -1;
+     }
+     for (int i = 0; i < limits->rlimitCount; i++) {
+         struct rlimit rl;
+         getrlimit(limits->resources[i], &rl);
+         rl.rlim_cur = limits->values[i];
+         if (rl.rlim_max != RLIM_INFINITY && rl.rlim_cur > rl.rlim_max) rl.rlim_cur = rl.rlim_max;
+         if (setrlimit(limits->resources[i], &rl) == -1) {
+             perror("limit: setrlimit");
+             return -1;
+         }
+     }
+     return 0;
+ }
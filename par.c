@@ -0,0 +1,218 @@
+/**
+ * @file par.c
+ * @brief `par`: run one command over many arguments with bounded concurrency.
+ *
+ *     par [-j N] command [args...] ::: arg...
+ *     par [-j N] command [args...] :::: file
+ *
+ * Each input argument replaces `{}` in the command's arguments, or is
+ * appended if there is no `{}`. At most N children (default: online CPUs)
+ * run at once; the runner blocks in `waitpid()` and starts the next input
+ * as soon as a child exits. Children go through the normal launcher and are
+ * recorded in the job table, so background jobs that finish in the meantime are
+ * still reaped and reported.
+ *
+ * Each child runs in a process group of its own, so the terminal's signals
+ * reach only the shell. Ctrl+C ends the run: no more inputs start, the
+ * running children get SIGTERM, and `par` returns 130 once they are gone.
+ * Ctrl+Z is ignored under `par` (it toggles foreground-only mode as usual).
+ */
+
+ #include "smallsh.h"
+ 
+ /**
+  * @brief Copies `arg` with every `{}` replaced by `value`.
+  */
+ static char *substitute(const char *arg, const char *value) {
+     size_t valueLen = strlen(value), len = 0;
+     const char *p;
+ 
+     for (p = arg; *p; p++) len += (p[0] == '{' && p[1] == '}') ? (p++, valueLen) : 1;
+ 
+     char *out = arenaAlloc(&lineArena, len + 1), *q = out;
+     for (p = arg; *p; p++) {
+         if (p[0] == '{' && p[1] == '}') {
+             memcpy(q, value, valueLen);
+             q += valueLen;
+             p++;
+         } else {
+             *q++ = *p;
+         }
+     }
+     *q = '\0';
+     return out;
+ }
+ 
+ /**
+  * @brief Builds the argument vector for one input.
+  */
+ static char **buildArgs(char **command, int commandCount, const char *value) {
+     char **args = arenaAlloc(&lineArena, (commandCount + 2) * sizeof *args);
+     int placed = 0;
+ 
+     for (int i = 0; i < commandCount; i++) {
+         if (strstr(command[i], "{}")) {
+             args[i] = substitute(command[i], value);
+             placed = 1;
+         } else {
+             args[i] = command[i];
+         }
+     }
+     if (!placed) args[commandCount++] = (char *)value;
+     args[commandCount] = NULL;
+     return args;
+ }
+ 
+ /**
+  * @brief Reads one input per line of `path` into the arena.
+  *
+  * @return Number of inputs, or `-1` if the file cannot be opened.
+  */
+ static int readInputs(const char *path, char ***inputs) {
+     struct lineReader reader;
+     int fd = open(path, O_RDONLY | O_CLOEXEC);
+     int count = 0, cap = 64;
+     char **list = malloc(cap * sizeof *list);
+     char *line;
+     size_t len;
+ 
+     if (fd == -1) {
+         free(list);
+         return -1;
+     }
+     readerInit(&reader, fd);
+     while ((line = readLine(&reader, &len))) {
+         if (len > 0 && line[len - 1] == '\n') len--;
+         if (count == cap) list = realloc(list, (cap *= 2) * sizeof *list);
+         list[count++] = arenaStrndup(&lineArena, line, len);
+     }
+     readerClose(&reader);
+ 
+     *inputs = arenaAlloc(&lineArena, (count + 1) * sizeof **inputs);
+     memcpy(*inputs, list, count * sizeof *list);
+     free(list);
+     return count;
+ }
+ 
+ /**
+  * @brief Ends an interrupted run: sends SIGTERM to the running children.
+  *
+  * They ignore SIGINT like background jobs. SIGCONT wakes one that stopped on
+  * terminal input.
+  */
+ static void stopChildren(const pid_t *pids, int count) {
+     for (int i = 0; i < count; i++) {
+         if (pids[i] == 0) continue;
+         kill(-pids[i], SIGTERM);
+         kill(-pids[i], SIGCONT);
+     }
+ }
+ 
+ /**
+  * @brief Built-in `par`: see the file comment for usage.
+  *
+  * Prints a summary to stderr when any input fails.
+  *
+  * @return `0` if every command exited with 0, otherwise the number of failures (at
+  *         most 100), or `130` if the run was interrupted.
+  */
+ int parBuiltin(char *args[]) {
+     long maxJobs = sysconf(_SC_NPROCESSORS_ONLN);
+     int i = 1;
+ 
+     if (args[i] && strcmp(args[i], "-j") == 0 && args[i + 1]) {
+         maxJobs = strtol(args[i + 1], NULL, 10);
+         i += 2;
+     } else if (args[i] && strncmp(args[i], "-j", 2) == 0 && args[i][2]) {
+         maxJobs = strtol(args[i] + 2, NULL, 10);
+         i++;
+     }
+     if (maxJobs < 1) maxJobs = 1;
+ 
+     char **command = &args[i];
+     int commandCount = 0;
+     while (command[commandCount] && strcmp(command[commandCount], ":::") != 0
+            && strcmp(command[commandCount], "::::") != 0) {
+         commandCount++;
+     }
+     if (commandCount == 0 || !command[commandCount]) {
+         fprintf(stderr, "par: usage: par [-j N] command [args...] ::: arg... | :::: file\n");
+         return 1;
+     }
+ 
+     char **inputs = &command[commandCount + 1];
+     int inputCount = 0;
+     if (strcmp(command[commandCount], "::::") == 0) {
+         if (!inputs[0] || (inputCount = readInputs(inputs[0], &inputs)) == -1) {
+             fprintf(stderr, "par: cannot read %s: %s\n", inputs[0] ? inputs[0] : "input file",
+                     inputs[0] ? strerror(errno) : "missing");
+             return 1;
+         }
+     } else {
+         while (inputs[inputCount]) inputCount++;
+     }
+ 
+     if (maxJobs > inputCount) maxJobs = inputCount ? inputCount : 1;
+     pid_t *runningPids = calloc(maxJobs, sizeof *runningPids);
+     int next = 0, running = 0, succeeded = 0, failed = 0, interrupted = 0;
+     while (next < inputCount || running > 0) {
+         while (!interrupted && next < inputCount && running < maxJobs) {
+             struct command cmd = { .args = buildArgs(command, commandCount, inputs[next++]) };
+             int status = W_EXITCODE(1, 0), cpu, node;
+             struct launchLimits placement;
+             int placed = nextPlacement(&placement, &cpu, &node);
+             pid_t pid = launchCommand(&cmd, 1, -1, -1, placed ? &placement : NULL); // Own group
+             if (pid == -1) {
+                 failed++;
+                 continue;
+             }
+             struct job *job = jobAdd(pid, &pid, &status, 1, joinArgs(cmd.args));
+             job->parallel = 1;
+             job->placedCPU = cpu;
+             job->placedNode = node;
+             for (int slot = 0; slot < maxJobs; slot++) {
+                 if (runningPids[slot] == 0) {
+                     runningPids[slot] = pid;
+                     break;
+                 }
+             }
+             running++;
+         }
+         if (running == 0) break;
+ 
+         int status, jobStatus;
+         struct rusage usage;
+         pid_t pid = interrupted ? waitChild(-1, &status, 0, &usage)
+                     : waitChildInterruptible(-1, &status, 0, &usage);
+         if (pid == -1 && errno == EINTR) { // Ctrl+C
+             interrupted = 1;
+             stopChildren(runningPids, maxJobs);
+             continue;
+         }
+         if (pid == -1) break;
+         struct job *job = jobFind(pid);
+         if (!job || !job->parallel) {
+             jobRecordStatus(pid, status, &usage, NULL); // Someone else's job: reported at the prompt
+             continue;
+         }
+         if (jobRecordStatus(pid, status, &usage, &jobStatus)) {
+             running--;
+             for (int slot = 0; slot < maxJobs; slot++) {
+                 if (runningPids[slot] == pid) runningPids[slot] = 0;
+             }
+             if (WIFSIGNALED(jobStatus) && WTERMSIG(jobStatus) == SIGINT && !interrupted) {
+                 interrupted = 1; // SIGINT sent to the child's group ends the run too
+                 stopChildren(runningPids, maxJobs);
+             }
+             if (WIFEXITED(jobStatus) && WEXITSTATUS(jobStatus) == 0) succeeded++;
+             else failed++;
+         }
+     }
+ 
+     free(runningPids);
+     if (interrupted) return 130;
+     if (failed > 0) {
+         fprintf(stderr, "par: %d jobs, %d succeeded, %d failed\n", succeeded + failed, succeeded, failed);
+     }
+     return failed > 100 ? 100 : failed;
+ }
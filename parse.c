@@ -0,0 +1,287 @@
+/**
+ * @file parse.c
+ * @brief Lexer and parser for smallsh command lines.
+ *
+ * `lexLine()` turns a raw line into an array of typed tokens in one linear
+ * scan, with no hidden state. `parseList()` splits the tokens at `;`, `&`,
+ * `&&` and `||`, and `parsePipeline()` builds each `struct pipeline` the
+ * launcher runs. All of them allocate only from the per-line arena.
+ */
+
+ #include "smallsh.h"
+ 
+ /**
+  * @brief Returns whether `c` ends a word.
+  */
+ static int isDelimiter(char c) {
+     return c == ' ' || c == '\t' || c == '\n' || c == '\r'
+         || c == '|' || c == '&' || c == ';' || c == '<' || c == '>';
+ }
+ 
+ /**
+  * @brief Splits a command line into tokens.
+  *
+  * Words are runs of characters up to whitespace or an operator, so
+  * operators need no surrounding spaces (`ls>out&` is three tokens and a
+  * background marker). Single and double quotes, backslashes and `$(...)`
+  * make delimiters part of a word; they are handled later, by `expandPipeline()`.
+  * A word starting with `#` begins a comment that runs to the end of the
+  * line. The array always ends with a `TOK_END` token.
+  *
+  * @param arena Arena for the token array and word text.
+  * @param line Line to scan (need not be NUL-terminated).
+  * @param len Length of `line`.
+  * @param tokens Set to the token array.
+  * @return Number of tokens, not counting `TOK_END`.
+  */
+ int lexLine(struct arena *arena, const char *line, size_t len, struct token **tokens) {
+     struct token *out = arenaAlloc(arena, (len + 1) * sizeof *out); // At most one token per byte
+     const char *end = line + len;
+     const char *p = line;
+     int count = 0;
+ 
+     while (p < end) {
+         char c = *p;
+         struct token *tok = &out[count];
+ 
+         if (c == ' ' || c == '\t' || c == '\n' || c == '\r') {
+             p++;
+             continue;
+         }
+         if (c == '#') break; // Comment
+ 
+         char next = p + 1 < end ? p[1] : '\0';
+         char third = p + 2 < end ? p[2] : '\0';
+         int width = 1;
+         switch (c) {
+         case '|':
+             if (next == '|') *tok = (struct token){ TOK_OR_IF, "||" }, width = 2;
+             else *tok = (struct token){ TOK_PIPE, "|" };
+             break;
+         case '&':
+             if (next == '&') *tok = (struct token){ TOK_AND_IF, "&&" }, width = 2;
+             else if (next == '>' && third == '>') *tok = (struct token){ TOK_REDIR_ALL_APPEND, "&>>" }, width = 3;
+             else if (next == '>') *tok = (struct token){ TOK_REDIR_ALL, "&>" }, width = 2;
+             else *tok = (struct token){ TOK_BACKGROUND, "&" };
+             break;
+         case ';':
+             *tok = (struct token){ TOK_SEMI, ";" };
+             break;
+         case '<':
+             if (next == '<' && third == '<') *tok = (struct token){ TOK_HERESTRING, "<<<" }, width = 3;
+             else if (next == '<') *tok = (struct token){ TOK_HEREDOC, "<<" }, width = 2;
+             else *tok = (struct token){ TOK_REDIR_IN, "<" };
+             break;
+         case '>':
+             if (next == '>') *tok = (struct token){ TOK_REDIR_APPEND, ">>" }, width = 2;
+             else if (next == '!') *tok = (struct token){ TOK_REDIR_PREALLOC, ">!" }, width = 2;
+             else *tok = (struct token){ TOK_REDIR_OUT, ">" };
+             break;
+         default: {
+             // `2>` only counts at the start of a word: `a2>f` is the word `a2` and `>`
+             if (c == '2' && next == '>') {
+                 if (third == '&' && p + 3 < end && p[3] == '1') *tok = (struct token){ TOK_ERR_TO_OUT, "2>&1" }, width = 4;
+                 else if (third == '>') *tok = (struct token){ TOK_REDIR_ERR_APPEND, "2>>" }, width = 3;
+                 else *tok = (struct token){ TOK_REDIR_ERR, "2>" }, width = 2;
+                 break;
+             }
+             // Quotes and backslashes stay in the word for expandPipeline(); here they
+             // only keep delimiters inside them from ending it
+             const char *start = p;
+             char quote = 0;
+             while (p < end && (quote || !isDelimiter(*p))) {
+                 if (quote != '\'' && *p == '$' && p + 1 < end && p[1] == '(') {
+                     const char *close = substitutionEnd(p + 2, end);
+                     if (!close) { // Never closed: like an open quote, it runs to the end
+                         quote = '(';
+                         p = end;
+                         break;
+                     }
+                     p = close;
+                 } else if (quote) {
+                     if (*p == quote) quote = 0;
+                     else if (quote == '"' && *p == '\\' && p + 1 < end) p++;
+                 } else if (*p == '\'' || *p == '"') {
+                     quote = *p;
+                 } else if (*p == '\\' && p + 1 < end) {
+                     p++;
+                 }
+                 p++;
+             }
+             if (quote) *tok = (struct token){ TOK_OPEN_QUOTE, quote == '(' ? "$(" : quote == '"' ? "\"" : "'" }; // Never closed
+             else *tok = (struct token){ TOK_WORD, arenaStrndup(arena, start, p - start) };
+             count++;
+             continue;
+         }
+         }
+         p += width;
+         count++;
+     }
+ 
+     out[count] = (struct token){ TOK_END, "newline" };
+     *tokens = out;
+     return count;
+ }
+ 
+ /**
+  * @brief Builds a pipeline from a token array.
+  *
+  * Accepts `word... [< file] [> file] | ... [&]`, with redirections anywhere
+  * in a stage. Output redirections are `>`, `>>`, `>!`, `2>`, `2>>`, `2>&1`,
+  * `&>` and `&>>`; a later one of the same stream replaces an earlier one,
+  * and `2>&1` follows stdout's final target whatever the order. Input comes
+  * from `<`, a `<<` here-doc (body filled in later by `readHereDocs()`) or
+  * a `<<<` here-string, whichever is last. `&` is only valid as the last token. List operators (`;`,
+  * `&&`, `||`) end the token range given; see `parseList()`.
+  *
+  * @param arena Arena for the stages and argument vectors.
+  * @param tokens Tokens from `lexLine()`.
+  * @param count Number of tokens.
+  * @param pipeline Filled in; `count` is 0 for a line with no command.
+  * @return `NULL` on success, or the text of the token where a syntax error was found.
+  */
+ const char *parsePipeline(struct arena *arena, struct token *tokens, int count, struct pipeline *pipeline) {
+     // Each word needs a slot plus each stage a NULL terminator: count + 1 slots suffice
+     char **args = arenaAlloc(arena, (count + 1) * sizeof *args);
+     struct command *stages = arenaAlloc(arena, (count / 2 + 1) * sizeof *stages);
+     int argCount = 0;
+ 
+     pipeline->stages = stages;
+     pipeline->count = 0;
+     pipeline->background = 0;
+     pipeline->timed = 0;
+     if (count == 0) return NULL;
+ 
+     stages[0] = (struct command){ .args = args };
+     for (int i = 0; i < count; i++) {
+         struct command *stage = &stages[pipeline->count];
+         struct token *tok = &tokens[i];
+ 
+         switch (tok->type) {
+         case TOK_WORD:
+             args[argCount++] = tok->text;
+             break;
+         case TOK_ERR_TO_OUT:
+             stage->errorFile = NULL;
+             stage->errorToOutput = 1;
+             break;
+         case TOK_HEREDOC:
+         case TOK_HERESTRING:
+             if (tokens[i + 1].type != TOK_WORD) return tokens[i + 1].text;
+             stage->inputFile = stage->hereDelimiter = stage->inputText = NULL;
+             if (tok->type == TOK_HEREDOC) {
+                 // Body is read by readHereDocs(); quoting any of the delimiter keeps it literal
+                 char *delimiter = tokens[++i].text;
+                 stage->inputExpand = strpbrk(delimiter, "'\"\\") ? INPUT_LITERAL : INPUT_HEREDOC;
+                 stage->hereDelimiter = removeQuotes(arena, delimiter);
+             } else {
+                 stage->inputLen = strlen(tokens[++i].text) + 1;
+                 stage->inputText = arenaAlloc(arena, stage->inputLen + 1);
+                 memcpy(stage->inputText, tokens[i].text, stage->inputLen - 1);
+                 stage->inputText[stage->inputLen - 1] = '\n';
+                 stage->inputText[stage->inputLen] = '\0';
+                 stage->inputExpand = INPUT_WORD;
+             }
+             break;
+         case TOK_REDIR_IN:
+         case TOK_REDIR_OUT:
+         case TOK_REDIR_APPEND:
+         case TOK_REDIR_PREALLOC:
+         case TOK_REDIR_ERR:
+         case TOK_REDIR_ERR_APPEND:
+         case TOK_REDIR_ALL:
+         case TOK_REDIR_ALL_APPEND: {
+             if (tokens[i + 1].type != TOK_WORD) return tokens[i + 1].text;
+             char *target = tokens[++i].text;
+             int mode = tok->type == TOK_REDIR_APPEND || tok->type == TOK_REDIR_ERR_APPEND
+                        || tok->type == TOK_REDIR_ALL_APPEND ? REDIR_APPEND
+                      : tok->type == TOK_REDIR_PREALLOC ? REDIR_PREALLOC : REDIR_TRUNCATE;
+             if (tok->type == TOK_REDIR_IN) {
+                 stage->inputFile = target;
+                 stage->hereDelimiter = stage->inputText = NULL;
+                 stage->inputExpand = INPUT_LITERAL;
+             } else if (tok->type == TOK_REDIR_ERR || tok->type == TOK_REDIR_ERR_APPEND) {
+                 stage->errorFile = target;
+                 stage->errorMode = mode;
+                 stage->errorToOutput = 0;
+             } else {
+                 stage->outputFile = target;
+                 stage->outputMode = mode;
+                 if (tok->type == TOK_REDIR_ALL || tok->type == TOK_REDIR_ALL_APPEND) {
+                     stage->errorFile = NULL;
+                     stage->errorToOutput = 1;
+                 }
+             }
+             break;
+         }
+         case TOK_PIPE:
+             if (stage->args == &args[argCount] || tokens[i + 1].type == TOK_END) return tok->text; // Empty stage
+             args[argCount++] = NULL; // Terminates this stage's args
+             stages[++pipeline->count] = (struct command){ .args = &args[argCount] };
+             break;
+         case TOK_BACKGROUND:
+             if (tokens[i + 1].type != TOK_END) return tokens[i + 1].text;
+             pipeline->background = 1;
+             break;
+         default:
+             return tok->text;
+         }
+     }
+     args[argCount] = NULL;
+ 
+     if (stages[pipeline->count].args == &args[argCount]) {
+         // Only a redirection or `&`: nothing to run
+         struct command *only = &stages[0];
+         if (pipeline->count > 0 || only->inputFile || only->hereDelimiter || only->inputText
+             || only->outputFile || only->errorFile || only->errorToOutput) {
+             return tokens[count].text;
+         }
+         return NULL;
+     }
+     pipeline->count++;
+     return NULL;
+ }
+ 
+ /**
+  * @brief Builds the list of pipelines on a line.
+  *
+  * The line is a flat and-or list: `;` and `&` separate pipelines (`&` also
+  * puts the one before it in the background), `&&` and `||` make the next
+  * pipeline conditional on the status of the last one that ran. Since the
+  * operators associate left to right with equal precedence, this flat form
+  * is the whole syntax tree.
+  *
+  * @param arena Arena for the pipelines.
+  * @param tokens Tokens from `lexLine()`.
+  * @param count Number of tokens.
+  * @param list Filled in; `count` is 0 for a line with no command.
+  * @return `NULL` on success, or the text of the token where a syntax error was found.
+  */
+ const char *parseList(struct arena *arena, struct token *tokens, int count, struct commandList *list) {
+     list->pipelines = arenaAlloc(arena, (count / 2 + 1) * sizeof *list->pipelines);
+     list->count = 0;
+ 
+     int start = 0, condition = LIST_ALWAYS;
+     for (int i = 0; i <= count; i++) {
+         int type = tokens[i].type;
+         if (type != TOK_SEMI && type != TOK_BACKGROUND && type != TOK_AND_IF && type != TOK_OR_IF && type != TOK_END) {
+             continue;
+         }
+ 
+         struct pipeline *pipeline = &list->pipelines[list->count];
+         const char *error = parsePipeline(arena, &tokens[start], i - start, pipeline);
+         if (error) return error;
+         if (pipeline->count == 0) {
+             // Nothing before the operator: only a trailing `;` or `&` after a command is allowed
+             if (type == TOK_END && (condition == LIST_ALWAYS || list->count == 0)) break;
+             return tokens[i].text;
+         }
+         pipeline->background = type == TOK_BACKGROUND;
+         pipeline->condition = condition;
+         list->count++;
+ 
+         condition = type == TOK_AND_IF ? LIST_AND : type == TOK_OR_IF ? LIST_OR : LIST_ALWAYS;
+         start = i + 1;
+     }
+     return NULL;
+ }
@@ -0,0 +1,210 @@
+/**
+ * @file pathhash.c
+ * @brief Command hash table for smallsh.
+ *
+ * Maps command names to the absolute path found on `$PATH`, like the
+ * `hash` builtin of other shells. A cached launch skips the directory
+ * walk (and the failed `execve` calls) that `execvp()` does every time.
+ * The table is flushed when `$PATH` changes and an entry is dropped
+ * when exec'ing its cached path fails.
+ */
+
+ #include "smallsh.h"
+ #include <sys/stat.h>
+ 
+ #define HASH_BUCKETS 256
+ 
+ struct hashEntry {
+     char *name;              // Command name as typed
+     char *path;              // Absolute path it resolved to
+     int hits;                // Number of launches served from the cache
+     struct hashEntry *next;  // Next entry in the same bucket
+ };
+ 
+ static struct hashEntry *hashTable[HASH_BUCKETS];
+ static char *hashedPATH = NULL; // Value of $PATH the table was built against
+ static int hashSize = 0;
+ 
+ /**
+  * @brief FNV-1a hash of a command name.
+  */
+ static unsigned hashName(const char *name) {
+     unsigned h = 2166136261u;
+     while (*name) {
+         h ^= (unsigned char)*name++;
+         h *= 16777619u;
+     }
+     return h % HASH_BUCKETS;
+ }
+ 
+ /**
+  * @brief Searches `$PATH` for an executable regular file called `name`.
+  *
+  * Follows `execvp()` rules: an empty `$PATH` element means the current
+  * directory.
+  *
+  * @return Newly allocated absolute path, or `NULL` if nothing matched.
+  */
+ static char *searchPATH(const char *name, const char *pathVar) {
+     size_t nameLen = strlen(name);
+     const char *dir = pathVar;
+ 
+     while (1) {
+         const char *end = strchr(dir, ':');
+         size_t dirLen = end ? (size_t)(end - dir) : strlen(dir);
+         char *candidate = malloc(dirLen + nameLen + 2);
+         struct stat st;
+ 
+         if (dirLen == 0) {
+             strcpy(candidate, name);
+         } else {
+             memcpy(candidate, dir, dirLen);
+             candidate[dirLen] = '/';
+             strcpy(candidate + dirLen + 1, name);
+         }
+         if (stat(candidate, &st) == 0 && S_ISREG(st.st_mode) && access(candidate, X_OK) == 0) {
+             return candidate;
+         }
+         free(candidate);
+ 
+         if (!end) return NULL;
+         dir = end + 1;
+     }
+ }
+ 
+ /**
+  * @brief Flushes the table if `$PATH` differs from the one it was built for.
+  */
+ static void checkPATH() {
+     const char *pathVar = varGet("PATH");
+     if (!pathVar) pathVar = "";
+ 
+     if (hashedPATH && strcmp(hashedPATH, pathVar) == 0) return;
+     hashClear();
+     free(hashedPATH);
+     hashedPATH = strdup(pathVar);
+ }
+ 
+ /**
+  * @brief Finds the entry for `name`, resolving and inserting it on a miss.
+  *
+  * @return Table entry, or `NULL` if `name` is not on `$PATH`.
+  */
+ static struct hashEntry *hashEntryFor(const char *name) {
+     unsigned bucket = hashName(name);
+ 
+     checkPATH();
+     for (struct hashEntry *e = hashTable[bucket]; e; e = e->next) {
+         if (strcmp(e->name, name) == 0) return e;
+     }
+ 
+     char *path = searchPATH(name, hashedPATH);
+     if (!path) return NULL;
+ 
+     struct hashEntry *e = malloc(sizeof *e);
+     e->name = strdup(name);
+     e->path = path;
+     e->hits = 0;
+     e->next = hashTable[bucket];
+     hashTable[bucket] = e;
+     hashSize++;
+     return e;
+ }
+ 
+ /**
+  * @brief Resolves a command name to an absolute path, using the cache.
+  *
+  * Names containing a `/` are never hashed. Lookups that miss are not
+  * cached, so a command installed later is found on the next try.
+  *
+  * @param name Command name (`args[0]`).
+  * @return Cached path owned by the table, or `NULL` if not found.
+  */
+ const char *hashLookup(const char *name) {
+     if (strchr(name, '/')) return NULL;
+ 
+     struct hashEntry *e = hashEntryFor(name);
+     if (!e) return NULL;
+     e->hits++;
+     return e->path;
+ }
+ 
+ /**
+  * @brief Drops the cached path for `name` (e.g. after its exec failed).
+  */
+ void hashForget(const char *name) {
+     struct hashEntry **link = &hashTable[hashName(name)];
+     while (*link) {
+         struct hashEntry *e = *link;
+         if (strcmp(e->name, name) == 0) {
+             *link = e->next;
+             free(e->name);
+             free(e->path);
+             free(e);
+             hashSize--;
+             return;
+         }
+         link = &e->next;
+     }
+ }
+ 
+ /**
+  * @brief Removes every entry (`hash -r`).
+  */
+ void hashClear() {
+     for (int i = 0; i < HASH_BUCKETS; i++) {
+         while (hashTable[i]) {
+             struct hashEntry *e = hashTable[i];
+             hashTable[i] = e->next;
+             free(e->name);
+             free(e->path);
+             free(e);
+         }
+     }
+     hashSize = 0;
+ }
+ 
+ /**
+  * @brief Built-in `hash [-r] [name ...]`.
+  *
+  * With no arguments, lists cached commands and their hit counts.
+  * `-r` forgets everything; each `name` is looked up and remembered.
+  *
+  * @param args Builtin arguments (null-terminated, `args[0]` is "hash").
+  * @return Exit status for `lastExitStatus`.
+  */
+ int hashBuiltin(char *args[]) {
+     int status = 0;
+     int i = 1;
+ 
+     if (args[i] && strcmp(args[i], "-r") == 0) {
+         hashClear();
+         i++;
+     }
+ 
+     if (!args[1]) {
+         checkPATH();
+         if (hashSize == 0) {
+             printf("hash: hash table empty\n");
+         } else {
+             printf("hits\tcommand\n");
+             for (int b = 0; b < HASH_BUCKETS; b++) {
+                 for (struct hashEntry *e = hashTable[b]; e; e = e->next) {
+                     printf("%4d\t%s\n", e->hits, e->path);
+                 }
+             }
+         }
+         flushOutput();
+         return 0;
+     }
+ 
+     for (; args[i]; i++) {
+         if (strchr(args[i], '/')) continue;
+         hashForget(args[i]);   // `hash name` re-resolves and resets hits
+         if (!hashEntryFor(args[i])) {
+             fprintf(stderr, "hash: %s: not found\n", args[i]);
+             status = 1;
+         }
+     }
+     return status;
+ }
@@ -0,0 +1,113 @@
+/**
+ * @file placement.c
+ * @brief Round-robin CPU and NUMA placement of background and `par` jobs.
+ *
+ *     set spread=off    leave placement to the kernel (default)
+ *     set spread=cpu    pin each new job to the next allowed CPU
+ *     set spread=numa   bind each new job to the next NUMA node's CPUs and
+ *                       prefer that node for its memory
+ *
+ * Nodes come from /sys/devices/system/node, limited to the CPUs the shell
+ * may run on. The forked child applies its placement before exec, like a
+ * `limit` prefix (see limits.c). The job table keeps it for `jobs -l`.
+ */
+
+ #include "smallsh.h"
+ #include <linux/mempolicy.h>
+ #include <sys/syscall.h>
+ 
+ #define MAX_NODES 64
+ 
+ int spreadMode = SPREAD_OFF;
+ 
+ static cpu_set_t allowed;             // CPUs the shell may use
+ static cpu_set_t nodeCPUs[MAX_NODES]; // Allowed CPUs of each node with any
+ static int nodeIDs[MAX_NODES];
+ static int nodeCount = -1;            // -1 until the topology has been read
+ static int nextCPU = 0, nextNode = 0;
+ 
+ /**
+  * @brief Reads the NUMA topology once, falling back to one node of all allowed CPUs.
+  */
+ static void readTopology() {
+     if (nodeCount != -1) return;
+     sched_getaffinity(0, sizeof allowed, &allowed);
+     nodeCount = 0;
+ 
+     for (int node = 0; node < 1024 && nodeCount < MAX_NODES; node++) {
+         char path[64], list[4096];
+         snprintf(path, sizeof path, "/sys/devices/system/node/node%d/cpulist", node);
+         FILE *file = fopen(path, "r");
+         if (!file) continue;
+         int ok = fgets(list, sizeof list, file) != NULL;
+         fclose(file);
+         list[strcspn(list, "\n")] = '\0';
+ 
+         cpu_set_t cpus;
+         if (!ok || parseCPUList(list, &cpus) == -1) continue;
+         CPU_AND(&cpus, &cpus, &allowed);
+         if (CPU_COUNT(&cpus) == 0) continue; // Memory-only node, or none of its CPUs allowed
+         nodeCPUs[nodeCount] = cpus;
+         nodeIDs[nodeCount++] = node;
+     }
+     if (nodeCount == 0) {
+         nodeCPUs[0] = allowed;
+         nodeIDs[0] = 0;
+         nodeCount = 1;
+     }
+ }
+ 
+ /**
+  * @brief Picks the next placement when `set spread` is on.
+  *
+  * @param limits Filled in with the CPU set and memory node to apply.
+  * @param cpu Set to the CPU chosen (`-1` for a whole node).
+  * @param node Set to the node chosen (`-1` in `cpu` mode).
+  * @return `1` if a placement was chosen, `0` if spreading is off.
+  */
+ int nextPlacement(struct launchLimits *limits, int *cpu, int *node) {
+     if (spreadMode == SPREAD_OFF) return 0;
+     readTopology();
+     memset(limits, 0, sizeof *limits);
+     limits->hasCpus = 1;
+     *cpu = *node = -1;
+ 
+     if (spreadMode == SPREAD_CPU) {
+         for (int tries = 0; tries < CPU_SETSIZE; tries++) {
+             int candidate = nextCPU;
+             nextCPU = (nextCPU + 1) % CPU_SETSIZE;
+             if (!CPU_ISSET(candidate, &allowed)) continue;
+             CPU_ZERO(&limits->cpus);
+             CPU_SET(candidate, &limits->cpus);
+             *cpu = candidate;
+             return 1;
+         }
+         limits->cpus = allowed;
+         return 1;
+     }
+ 
+     int index = nextNode;
+     nextNode = (nextNode + 1) % nodeCount;
+     limits->cpus = nodeCPUs[index];
+     limits->memNode = *node = nodeIDs[index];
+     limits->hasMemNode = 1;
+     return 1;
+ }
+ 
+ /**
+  * @brief Makes `node` the preferred node for the calling process's memory.
+  *
+  * Preferred rather than bound, so a full node spills over instead of
+  * failing allocations.
+  *
+  * @return `0` on success, `-1` with `errno` set.
+  */
+ int preferMemoryNode(int node) {
+     unsigned long mask[MAX_NODES / (8 * sizeof(unsigned long)) + 16] = {0};
+     if (node < 0 || node >= (int)(8 * sizeof mask)) {
+         errno = EINVAL;
+         return -1;
+     }
+     mask[node / (8 * sizeof mask[0])] |= 1UL << node % (8 * sizeof mask[0]);
+     return syscall(SYS_set_mempolicy, MPOL_PREFERRED, mask, 8 * sizeof mask + 1);
+ }
@@ -5,28 +5,36 @@
  * This shell provides functionality for executing commands,
  * handling input/output redirection, background execution,
  * and built-in commands (`exit`, `cd`, `status`).
- * It also includes custom signal handlers for `SIGINT` (Ctrl+C)
+ * It also includes custom handling for `SIGINT` (Ctrl+C)
  * and `SIGTSTP` (Ctrl+Z).
  */
 
  #include "smallsh.h"
 
- /** 
-  * @brief Signal handler for SIGTSTP (Ctrl+Z).
-  * 
-  * Toggles foreground-only mode when Ctrl+Z is pressed.
+ // Global variables
+ int foregroundOnly = 0;  // Mode toggle for foreground-only mode
+ int lastExitStatus = 0;  // Stores exit status of last foreground process
+ int launchMode = DEFAULT_LAUNCH_MODE; // Engine used by executeCommand (SMALLSH_LAUNCH)
+ int pipefail = 0;        // `set -o pipefail`: pipeline fails if any stage fails
+ int fastcat = 1;         // `set -o fastcat`: copy plain `cat` redirections in-process
+ int interactive = 0;     // Reading commands from a terminal: prompt and flush eagerly
+ struct arena lineArena;  // Per-line storage, reset before each command line
+ long long preallocBytes = 0; // `set prealloc=SIZE`: bytes `>!` reserves with fallocate
+ 
+ /**
+  * @brief Toggles foreground-only mode (on SIGTSTP, Ctrl+Z).
+  *
   * If in foreground-only mode, background execution (`&`) is ignored.
-  * 
-  * @param signo Signal number (SIGTSTP).
+  * Runs from the event loop, not in signal context (see events.c).
   */
- void handle_SIGTSTP(int signo) {
-     if (foregroundOnly == 0) {
-         foregroundOnly = 1;
-         write(STDOUT_FILENO, "\nEntering foreground-only mode (& is now ignored)\n", 50);
+ void toggleForegroundOnly() {
+     foregroundOnly = !foregroundOnly;
+     if (foregroundOnly) {
+         printf("\nEntering foreground-only mode (& is now ignored)\n");
      } else {
-         foregroundOnly = 0;
-         write(STDOUT_FILENO, "\nExiting foreground-only mode\n", 30);
+         printf("\nExiting foreground-only mode\n");
      }
+     fflush(stdout);
  }
  
  /**
@@ -40,187 +48,467 @@
  }
  
  /**
-  * @brief Checks for completed background processes and reaps them.
+  * @brief Flushes shell messages right away, but only when interactive.
   *
-  * Uses `waitpid()` with `WNOHANG` flag to check if a background process has completed.
-  * If a process has terminated, prints its exit status or termination signal.
+  * In batch mode stdout stays fully buffered; the launcher flushes it
+  * before starting a child, so output still appears in order.
   */
- void checkBackgroundProcesses() {
-     int status;
-     pid_t pid;
-     for (int i = 0; i < bgCount; i++) {
-         pid = waitpid(bgProcesses[i], &status, WNOHANG);
-         if (pid > 0) {
-             printf("background pid %d is done: ", pid);
-             if (WIFEXITED(status)) {
-                 printf("exit value %d\n", WEXITSTATUS(status));
-             } else {
-                 printf("terminated by signal %d\n", WTERMSIG(status));
-             }
-             fflush(stdout);
-         }
+ void flushOutput() {
+     if (interactive) fflush(stdout);
+ }
+ 
+ /**
+  * @brief Stream for job and status notices: stdout, or stderr inside `$(...)`
+  * so that they stay out of the substituted text.
+  */
+ FILE *noticeOutput() {
+     return substitutionDepth > 0 ? stderr : stdout;
+ }
+ 
+ /**
+  * @brief Parses a byte count with an optional `K`, `M` or `G` suffix.
+  *
+  * @return The size, or `-1` if `text` is not a valid size.
+  */
+ long long parseSize(const char *text) {
+     char *end;
+     long long size = strtoll(text, &end, 10);
+     if (end == text || size < 0) return -1;
+     switch (*end) {
+     case 'G': case 'g': size <<= 10; // Fall through
+     case 'M': case 'm': size <<= 10; // Fall through
+     case 'K': case 'k': size <<= 10; end++;
      }
+     return *end == '\0' ? size : -1;
  }
  
  /**
-  * @brief Executes a given command with I/O redirection and background execution.
+  * @brief Built-in `set [-o|+o option | name=value ...]`: sets shell options.
   *
-  * Handles:
-  * - Input redirection (`<`)
-  * - Output redirection (`>`)
-  * - Background execution (`&`)
-  * - Foreground execution with proper signal handling
+  * `-o`/`+o` turn a flag on or off; `name=value` sets a size or choice setting.
+  * With no arguments, lists every option and its value.
   *
-  * @param args Array of command arguments (null-terminated).
-  * @param background Flag for background execution (`1` = background, `0` = foreground).
-  * @param inputFile Name of input file (`NULL` if not specified).
-  * @param outputFile Name of output file (`NULL` if not specified).
+  * @param args Builtin arguments (null-terminated).
+  * @return Exit status for `lastExitStatus`.
   */
- void executeCommand(char *args[], int background, char *inputFile, char *outputFile) {
-     pid_t spawnPid = fork();
-     int childStatus;
- 
-     if (spawnPid == -1) {
-         perror("fork() failed");
-         exit(1);
-     } else if (spawnPid == 0) { // Child process
-         // Handle input redirection
-         if (inputFile) {
-             int inputFD = open(inputFile, O_RDONLY);
-             if (inputFD == -1) {
-                 perror("cannot open input file");
-                 exit(1);
-             }
-             dup2(inputFD, STDIN_FILENO);
-             close(inputFD);
+ int setBuiltin(char *args[]) {
+     struct { const char *name; int *flag; } options[] = {
+         { "fastcat", &fastcat },
+         { "pipefail", &pipefail },
+         { "tagoutput", &tagOutput },
+     };
+     struct { const char *name; long long *size; } sizes[] = {
+         { "prealloc", &preallocBytes },
+     };
+     struct { const char *name; int *choice; const char *values[4]; } choices[] = {
+         { "spread", &spreadMode, { "off", "cpu", "numa" } }, // Indexed by SPREAD_*
+     };
+     int optionCount = sizeof options / sizeof options[0];
+     int sizeCount = sizeof sizes / sizeof sizes[0];
+     int choiceCount = sizeof choices / sizeof choices[0];
+ 
+     if (!args[1]) {
+         for (int i = 0; i < optionCount; i++) {
+             printf("%-12s%s\n", options[i].name, *options[i].flag ? "on" : "off");
          }
+         for (int i = 0; i < sizeCount; i++) {
+             printf("%-12s%lld\n", sizes[i].name, *sizes[i].size);
+         }
+         for (int i = 0; i < choiceCount; i++) {
+             printf("%-12s%s\n", choices[i].name, choices[i].values[*choices[i].choice]);
+         }
+         flushOutput();
+         return 0;
+     }
  
-         // Handle output redirection
-         if (outputFile) {
-             int outputFD = open(outputFile, O_WRONLY | O_CREAT | O_TRUNC, 0644);
-             if (outputFD == -1) {
-                 perror("cannot open output file");
-                 exit(1);
+     for (int i = 1; args[i]; i++) {
+         char *equals = strchr(args[i], '=');
+         if (equals) {
+             int found = 0, nameLen = equals - args[i];
+             for (int j = 0; j < choiceCount; j++) {
+                 if (strncmp(args[i], choices[j].name, nameLen) != 0 || choices[j].name[nameLen]) continue;
+                 int value = -1;
+                 for (int k = 0; choices[j].values[k]; k++) {
+                     if (strcmp(equals + 1, choices[j].values[k]) == 0) value = k;
+                 }
+                 if (value == -1) {
+                     fprintf(stderr, "set: %s: invalid value for %s\n", equals + 1, choices[j].name);
+                     return 1;
+                 }
+                 *choices[j].choice = value;
+                 found = 1;
              }
-             dup2(outputFD, STDOUT_FILENO);
-             close(outputFD);
+             for (int j = 0; j < sizeCount; j++) {
+                 if (strncmp(args[i], sizes[j].name, equals - args[i]) != 0 || sizes[j].name[equals - args[i]]) continue;
+                 long long size = parseSize(equals + 1);
+                 if (size == -1) {
+                     fprintf(stderr, "set: %s: invalid size\n", equals + 1);
+                     return 1;
+                 }
+                 *sizes[j].size = size;
+                 found = 1;
+             }
+             if (!found) {
+                 fprintf(stderr, "set: %.*s: invalid setting name\n", (int)(equals - args[i]), args[i]);
+                 return 1;
+             }
+             continue;
          }
  
-         // Set signal handling
-         struct sigaction ignoreAction = {0};
-         ignoreAction.sa_handler = SIG_IGN;
-         sigaction(SIGTSTP, &ignoreAction, NULL); // Ignore Ctrl+Z in child process
+         int value = strcmp(args[i], "-o") == 0;
+         if (!value && strcmp(args[i], "+o") != 0) {
+             fprintf(stderr, "set: %s: invalid option\n", args[i]);
+             return 1;
+         }
+         if (!args[++i]) {
+             fprintf(stderr, "set: %s: option name required\n", args[i - 1]);
+             return 1;
+         }
  
-         if (!background) {
-             struct sigaction defaultAction = {0};
-             defaultAction.sa_handler = SIG_DFL;
-             sigaction(SIGINT, &defaultAction, NULL); // Allow Ctrl+C in foreground
+         int found = 0;
+         for (int j = 0; j < optionCount; j++) {
+             if (strcmp(args[i], options[j].name) == 0) {
+                 *options[j].flag = value;
+                 found = 1;
+             }
+         }
+         if (!found) {
+             fprintf(stderr, "set: %s: invalid option name\n", args[i]);
+             return 1;
          }
+     }
+     return 0;
+ }
  
-         // Execute the command
-         if (execvp(args[0], args) == -1) {
-             perror("command not found");
-             exit(1);
+ static int oneShot = 0; // `smallsh -c`: run one line, then exit with its status
+ static int nestedExit = 0; // `exit` ran inside `$(...)`: the rest of that command is skipped
+ static int substituted = 0; // The pipeline about to run had a `$(...)`, whose status is `lastExitStatus`
+ 
+ /**
+  * @brief Status for `exit [N]`: N, or the last command's status without it.
+  */
+ static int exitStatus(char **args, int argCount) {
+     return argCount > 1 ? atoi(args[1]) : lastExitStatus;
+ }
+ 
+ /**
+  * @brief Runs one pipeline: a builtin in the shell itself, anything else through the launcher.
+  *
+  * Builtins only run as a whole pipeline, not as pipeline stages. A
+  * command whose words all expanded to nothing (`$UNSET`) only applies its
+  * redirections. That and a line of assignments have the status of their
+  * last `$(...)`, or `0` without one.
+  *
+  * @param last Set for the final pipeline of a `smallsh -c` line, which may replace the shell.
+  */
+ static void runPipeline(struct pipeline *pipeline, int last) {
+     struct command *stages = pipeline->stages;
+     char **args = stages[0].args;
+     int argCount = 0;
+     while (args[argCount]) argCount++;
+ 
+     int catStatus, utilityStatus;
+     if (!args[0] && pipeline->count == 1) {
+         int saved[3];
+         if (applyRedirections(&stages[0], saved) == -1) lastExitStatus = 1;
+         else if (!substituted) lastExitStatus = 0;
+         restoreRedirections(saved);
+         return;
+     } else if (args[0] && strcmp(args[0], "time") == 0 && argCount > 1) {
+         // `time command`: run the rest of the pipeline, then report how long it took
+         struct timespec start, end;
+         struct rusage before, after;
+         clock_gettime(CLOCK_MONOTONIC, &start);
+         getrusage(RUSAGE_SELF, &before);
+         stages[0].args++;
+         pipeline->timed = 1;
+         runPipeline(pipeline, 0); // Never in place: the report comes afterwards
+         if (pipeline->timed) {
+             // Not launched (a builtin): report the shell's own usage
+             clock_gettime(CLOCK_MONOTONIC, &end);
+             getrusage(RUSAGE_SELF, &after);
+             struct commandTiming timing = {
+                 .realUs = elapsedUs(&start, &end),
+                 .userUs = timevalUs(&after.ru_utime) - timevalUs(&before.ru_utime),
+                 .sysUs = timevalUs(&after.ru_stime) - timevalUs(&before.ru_stime),
+                 .maxRssKB = after.ru_maxrss,
+             };
+             timeReport(&timing);
+             pipeline->timed = 0;
          }
-     } else { // Parent process
-         if (background && !foregroundOnly) {
-             printf("background pid is %d\n", spawnPid);
-             fflush(stdout);
-             bgProcesses[bgCount++] = spawnPid;
-         } else {
-             waitpid(spawnPid, &childStatus, 0); // Wait for foreground process
-             if (WIFEXITED(childStatus)) {
-                 lastExitStatus = WEXITSTATUS(childStatus);
-             } else {
-                 printf("terminated by signal %d\n", WTERMSIG(childStatus));
-                 fflush(stdout);
-                 lastExitStatus = WTERMSIG(childStatus);
+         return;
+     }
+ 
+     // Handle built-in commands (only as a whole pipeline, not as pipeline stages)
+     if (args[0] && strcmp(args[0], "bench") == 0) { // Times the whole pipeline
+         lastExitStatus = benchBuiltin(pipeline);
+         return;
+     } else if (pipeline->count > 1) {
+         executeCommand(pipeline);
+         return;
+     } else if (isAssignment(args[0])) {
+         // `NAME=value ...` on its own sets shell variables
+         for (int i = 0; i < argCount; i++) {
+             if (!isAssignment(args[i])) {
+                 fprintf(stderr, "%s: assignments before a command are not supported\n", args[0]);
+                 lastExitStatus = 1;
+                 return;
              }
          }
+         for (int i = 0; i < argCount; i++) varAssign(args[i], 0);
+         if (!substituted) lastExitStatus = 0;
+         return;
+     } else if (strcmp(args[0], "exit") == 0 && substitutionDepth > 0) {
+         // Only leaves the substitution, as it would leave a subshell
+         lastExitStatus = exitStatus(args, argCount);
+         nestedExit = 1;
+         return;
+     } else if (strcmp(args[0], "exit") == 0) {
+         int status = exitStatus(args, argCount);
+         coprocCloseAll();
+         signalAllJobs(SIGTERM);
+         tagDetach();
+         eventLogFlush();
+         exit(status);
+     } else if (strcmp(args[0], "cd") == 0) {
+         // The status matters now that `cd dir && cmd` can depend on it
+         lastExitStatus = chdir(argCount > 1 ? args[1] : varGet("HOME")) != 0;
+         if (lastExitStatus) perror("cd failed");
+         return;
+     } else if (strcmp(args[0], "status") == 0) {
+         printf("exit value %d\n", lastExitStatus);
+         flushOutput();
+         return;
+     } else if (strcmp(args[0], "history") == 0) {
+         lastExitStatus = historyBuiltin(args);
+         return;
+     } else if (strcmp(args[0], "export") == 0) {
+         lastExitStatus = exportBuiltin(args);
+         return;
+     } else if (strcmp(args[0], "unset") == 0) {
+         lastExitStatus = unsetBuiltin(args);
+         return;
+     } else if (strcmp(args[0], "hash") == 0) {
+         lastExitStatus = hashBuiltin(args);
+         return;
+     } else if (strcmp(args[0], "jobs") == 0) {
+         lastExitStatus = jobsBuiltin(args);
+         return;
+     } else if ((strcmp(args[0], "fg") == 0 || strcmp(args[0], "bg") == 0) && substitutionDepth > 0) {
+         fprintf(stderr, "%s: no job control in command substitution\n", args[0]);
+         lastExitStatus = 1;
+         return;
+     } else if (strcmp(args[0], "fg") == 0) {
+         lastExitStatus = fgBuiltin(args);
+         return;
+     } else if (strcmp(args[0], "bg") == 0) {
+         lastExitStatus = bgBuiltin(args);
+         return;
+     } else if (strcmp(args[0], "ulimit") == 0) {
+         lastExitStatus = ulimitBuiltin(args);
+         return;
+     } else if (strcmp(args[0], "kill") == 0) {
+         lastExitStatus = killBuiltin(args);
+         return;
+     } else if (strcmp(args[0], "wait") == 0) {
+         lastExitStatus = waitBuiltin(args);
+         return;
+     } else if (strcmp(args[0], "par") == 0) {
+         lastExitStatus = parBuiltin(args);
+         return;
+     } else if (strcmp(args[0], "coproc") == 0) {
+         lastExitStatus = coprocBuiltin(args);
+         return;
+     } else if (strcmp(args[0], "send") == 0) {
+         lastExitStatus = sendBuiltin(args);
+         return;
+     } else if (strcmp(args[0], "recv") == 0) {
+         lastExitStatus = recvBuiltin(args);
+         return;
+     } else if (strcmp(args[0], "timing") == 0) {
+         lastExitStatus = timingBuiltin(args);
+         return;
+     } else if (strcmp(args[0], "stats") == 0) {
+         lastExitStatus = statsBuiltin(args);
+         return;
+     } else if (strcmp(args[0], "set") == 0) {
+         lastExitStatus = setBuiltin(args);
+         return;
+     } else if ((utilityStatus = runUtility(&stages[0], pipeline->background)) != -1) {
+         lastExitStatus = utilityStatus;
+         return;
+     } else if (strcmp(args[0], "cat") == 0 && (catStatus = fastCat(&stages[0], pipeline->background)) != -1) {
+         lastExitStatus = catStatus;
+         return;
+     }
+ 
+     // The last command of `smallsh -c` has nothing to return to, so it needs no fork
+     // (unless the shell still copies tagged job output)
+     if (last && pipeline->count == 1 && !pipeline->background && !timingEnabled && !tagStreamsOpen()) {
+         lastExitStatus = execInPlace(&stages[0]);
+         return;
      }
+ 
+     // Execute non-built-in commands
+     executeCommand(pipeline);
  }
  
  /**
-  * @brief Main function that runs the smallsh shell.
+  * @brief Runs a line's pipelines in order, skipping `&&`/`||` branches by `lastExitStatus`.
   *
-  * - Initializes signal handlers for `SIGTSTP` (Ctrl+Z) and `SIGINT` (Ctrl+C).
-  * - Reads user input, processes built-in commands, and executes external commands.
-  * - Handles input/output redirection and background execution.
+  * Only the leaf commands are launched; the list itself is evaluated in
+  * the shell, so `a && b || c` costs at most three launches.
+  */
+ static void runList(struct commandList *list) {
+     for (int i = 0; i < list->count && !nestedExit; i++) {
+         struct pipeline *pipeline = &list->pipelines[i];
+         if (pipeline->condition == LIST_AND && lastExitStatus != 0) continue;
+         if (pipeline->condition == LIST_OR && lastExitStatus == 0) continue;
+         int runsBefore = substitutionsRun;
+         if (expandPipeline(&lineArena, pipeline) == -1) { // Just before it runs, so `$?` is current
+             lastExitStatus = 1;
+             continue;
+         }
+         substituted = substitutionsRun != runsBefore;
+         runPipeline(pipeline, oneShot && i == list->count - 1);
+     }
+ }
+ 
+ /**
+  * @brief Runs `len` bytes of command text as a list of its own (the inside of `$(...)`).
   *
-  * @return `EXIT_SUCCESS` when the shell terminates.
+  * Like a line, except that nothing is exec'd in place of the shell and a
+  * here-document gets an empty body. `exit` ends just this list, with its
+  * argument (or the last status) as the status.
   */
- int main() {
-     struct sigaction SIGTSTP_action = {0};
-     SIGTSTP_action.sa_handler = handle_SIGTSTP;
-     sigfillset(&SIGTSTP_action.sa_mask);
-     SIGTSTP_action.sa_flags = SA_RESTART;
-     sigaction(SIGTSTP, &SIGTSTP_action, NULL);
- 
-     struct sigaction SIGINT_action = {0};
-     SIGINT_action.sa_handler = SIG_IGN;
-     sigfillset(&SIGINT_action.sa_mask);
-     SIGINT_action.sa_flags = 0;
-     sigaction(SIGINT, &SIGINT_action, NULL);
+ void runNested(const char *text, size_t len) {
+     struct token *tokens;
+     struct commandList list;
+     int tokenCount = lexLine(&lineArena, text, len, &tokens);
+     const char *syntaxError = parseList(&lineArena, tokens, tokenCount, &list);
+     if (syntaxError) {
+         fprintf(stderr, "syntax error near unexpected token `%s'\n", syntaxError);
+         lastExitStatus = 1;
+         return;
+     }
+     int wasOneShot = oneShot;
+     oneShot = 0;
+     runList(&list);
+     oneShot = wasOneShot;
+     nestedExit = 0;
+ }
  
-     while (1) {
-         checkBackgroundProcesses();
-         prompt();
+ #ifndef SMALLSH_NO_MAIN // smallsh-bench (benchdriver.c) links this file without main()
+ /**
+  * @brief Runs one command line read from `reader`.
+  *
+  * Terminal lines go through `!` expansion and into the history file
+  * first. The line is then lexed and parsed, any here-document bodies are
+  * read from `reader`, and the list is run. A line that cannot be expanded
+  * or parsed sets exit value 1 and runs nothing.
+  */
+ static void runLine(struct lineReader *reader, char *line, size_t lineLen) {
+     // Everything for this line lives in the arena until the next line
+     arenaReset(&lineArena);
  
-         char input[MAX_INPUT];
-         if (!fgets(input, MAX_INPUT, stdin)) {
-             clearerr(stdin);
-             continue;
+     if (interactive) {
+         line = historyExpand(&lineArena, line, &lineLen);
+         if (!line) {
+             lastExitStatus = 1;
+             return;
          }
+         historyAdd(line, lineLen);
+     }
  
-         if (input[0] == '#' || input[0] == '\n') continue; // Ignore comments & blank lines
- 
-         char *args[MAX_ARGS];
-         char *token = strtok(input, " \n");
-         int argCount = 0;
-         int background = 0;
-         char *inputFile = NULL, *outputFile = NULL;
- 
-         while (token) {
-             if (strcmp(token, "<") == 0) {
-                 token = strtok(NULL, " \n");
-                 inputFile = token;
-             } else if (strcmp(token, ">") == 0) {
-                 token = strtok(NULL, " \n");
-                 outputFile = token;
-             } else if (strcmp(token, "&") == 0 && strtok(NULL, " \n") == NULL) {
-                 background = 1;
-             } else {
-                 args[argCount++] = token;
-             }
-             token = strtok(NULL, " \n");
+     struct token *tokens;
+     struct commandList list;
+     int tokenCount = lexLine(&lineArena, line, lineLen, &tokens);
+     const char *syntaxError = parseList(&lineArena, tokens, tokenCount, &list);
+     if (syntaxError) {
+         fprintf(stderr, "syntax error near unexpected token `%s'\n", syntaxError);
+         lastExitStatus = 1;
+         return;
+     }
+     for (int i = 0; i < list.count; i++) readHereDocs(reader, &list.pipelines[i]);
+     runList(&list);
+ }
+ 
+ /**
+  * @brief Main function that runs the smallsh shell.
+  *
+  * - Routes `SIGTSTP` (Ctrl+Z), `SIGINT` (Ctrl+C) and `SIGCHLD` through the
+  *   event loop (see events.c), which also waits for terminal input.
+  * - Reads commands from the terminal, from `script` if one is given, or from a
+  *   non-terminal stdin. Only terminal input gets a prompt; other input is read
+  *   in bulk (see input.c) and the shell exits with the last status at EOF.
+  * - Processes built-in commands and executes external commands.
+  * - Tokenizes each line (see parse.c) into a list of pipelines joined by
+  *   `;`, `&`, `&&` and `||`, and handles input/output redirection and
+  *   background execution.
+  *
+  * - With `-c line`, runs just that line (here-doc bodies may follow it on
+  *   later lines of the same argument) and exits with its status; a final
+  *   simple command is exec'd in place of the shell.
+  *
+  * Usage: `smallsh [script]` or `smallsh -c line`
+  *
+  * @return Status of the last command when input runs out.
+  */
+ int main(int argc, char *argv[]) {
+     char *mode = getenv("SMALLSH_LAUNCH");
+     if (mode && strcmp(mode, "fork") == 0) launchMode = LAUNCH_FORK;
+     else if (mode && strcmp(mode, "spawn") == 0) launchMode = LAUNCH_SPAWN;
+     timingInit();
+     varsInit();
+     eventLogInit();
+ 
+     struct lineReader reader;
+     int inputFD = STDIN_FILENO;
+     if (argc > 1 && strcmp(argv[1], "-c") == 0) {
+         if (argc < 3) {
+             fprintf(stderr, "smallsh: -c: option requires an argument\nUsage: smallsh [script] or smallsh -c line\n");
+             exit(2);
+         }
+         oneShot = 1;
+         inputFD = -1;
+         readerInitString(&reader, argv[2], strlen(argv[2]));
+     } else if (argc > 1) {
+         inputFD = open(argv[1], O_RDONLY | O_CLOEXEC);
+         if (inputFD == -1) {
+             perror(argv[1]);
+             exit(1);
          }
-         args[argCount] = NULL;
+     }
+     interactive = inputFD == STDIN_FILENO && isatty(STDIN_FILENO);
+     if (!oneShot) readerInit(&reader, inputFD);
+     eventsInit(inputFD);
+     if (interactive) jobControlInit();
  
-         if (argCount == 0) continue;
+     while (1) {
+         handleSignals(0);
+         eventLogFlush(); // Start records of the last line's jobs
+         if (interactive) {
+             prompt();
+             waitForInput(&reader);
+         }
  
-         // Handle built-in commands
-         if (strcmp(args[0], "exit") == 0) {
-             for (int i = 0; i < bgCount; i++) {
-                 kill(bgProcesses[i], SIGTERM);
-             }
-             exit(0);
-         } else if (strcmp(args[0], "cd") == 0) {
-             if (argCount > 1) {
-                 if (chdir(args[1]) != 0) {
-                     perror("cd failed");
-                 }
-             } else {
-                 chdir(getenv("HOME"));
-             }
-             continue;
-         } else if (strcmp(args[0], "status") == 0) {
-             printf("exit value %d\n", lastExitStatus);
+         size_t lineLen;
+         char *line = readLine(&reader, &lineLen);
+         if (!line) {
+             if (interactive) continue; // Ignore Ctrl+D at the terminal
+             tagDetach();
              fflush(stdout);
-             continue;
+             eventLogFlush();
+             exit(lastExitStatus);
          }
  
-         // Execute non-built-in commands
-         executeCommand(args, background, inputFile, outputFile);
+         runLine(&reader, line, lineLen);
+         if (oneShot) break;
      }
+     tagDetach();
+     fflush(stdout);
+     eventLogFlush();
+     return lastExitStatus;
  }
- 
\ No newline at end of file
+ 
+ #endif
@@ -1,3 +1,4 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
@@ -5,19 +6,323 @@
 #include <sys/types.h>
 #include <sys/wait.h>
 #include <fcntl.h>
+#include <errno.h>
 #include <signal.h>
+#include <spawn.h>
+#include <time.h>
+#include <sys/resource.h>
+#include <sched.h>
 
-#define MAX_INPUT 2048
-#define MAX_ARGS 512
+// Job states
+#define JOB_RUNNING 0
+#define JOB_STOPPED 1
+
+// Launch engines for external commands
+#define LAUNCH_SPAWN 0           // posix_spawn (vfork-style, no page table copy)
+#define LAUNCH_FORK 1            // classic fork() + exec
+
+// Placement of new background and `par` jobs (`set spread=`)
+#define SPREAD_OFF 0
+#define SPREAD_CPU 1             // One CPU per job, round-robin
+#define SPREAD_NUMA 2            // One NUMA node per job, round-robin
+
+#ifndef DEFAULT_LAUNCH_MODE
+#define DEFAULT_LAUNCH_MODE LAUNCH_SPAWN
+#endif
+
+// Token types produced by lexLine()
+#define TOK_WORD 0
+#define TOK_REDIR_IN 1           // <
+#define TOK_REDIR_OUT 2          // >
+#define TOK_PIPE 3               // |
+#define TOK_BACKGROUND 4         // &
+#define TOK_SEMI 5               // ;
+#define TOK_AND_IF 6             // &&
+#define TOK_OR_IF 7              // ||
+#define TOK_END 8                // End of line
+#define TOK_REDIR_APPEND 9       // >>
+#define TOK_REDIR_PREALLOC 10    // >!
+#define TOK_REDIR_ERR 11         // 2>
+#define TOK_REDIR_ERR_APPEND 12  // 2>>
+#define TOK_ERR_TO_OUT 13        // 2>&1
+#define TOK_REDIR_ALL 14         // &>
+#define TOK_REDIR_ALL_APPEND 15  // &>>
+#define TOK_HEREDOC 16           // <<
+#define TOK_HERESTRING 17        // <<<
+#define TOK_OPEN_QUOTE 18        // Quote with no closing quote on the line
+
+// When a pipeline in a list runs, given the previous one's status
+#define LIST_ALWAYS 0            // First in the list, or after `;` / `&`
+#define LIST_AND 1               // After `&&`: only if the previous succeeded
+#define LIST_OR 2                // After `||`: only if the previous failed
+
+// How expandPipeline() treats a command's inputText
+#define INPUT_LITERAL 0          // No expansion: a here-doc with a quoted delimiter
+#define INPUT_WORD 1             // `<<<` word: quotes and `$` as in arguments
+#define INPUT_HEREDOC 2          // Here-doc body: `$` expands, quotes are literal
+
+// How an output redirection opens its file
+#define REDIR_TRUNCATE 0         // > (O_TRUNC)
+#define REDIR_APPEND 1           // >> (O_APPEND)
+#define REDIR_PREALLOC 2         // >! (O_TRUNC, then fallocate `set prealloc=SIZE` bytes)
+
+struct token {
+    int type;                // TOK_*
+    char *text;              // Word text, or the operator as written
+};
+
+// One stage of a pipeline
+struct command {
+    char **args;             // Command arguments (null-terminated)
+    char *inputFile;         // `<` target, or NULL
+    char *hereDelimiter;     // `<<` delimiter whose body is still to be read, or NULL
+    char *inputText;         // Here-doc or here-string content for stdin, or NULL
+    size_t inputLen;         // Length of inputText
+    char *outputFile;        // `>` target, or NULL
+    int outputMode;          // REDIR_* for outputFile
+    char *errorFile;         // `2>` target, or NULL
+    int errorMode;           // REDIR_* for errorFile
+    int errorToOutput;       // `2>&1` or `&>`: stderr goes wherever stdout goes
+    int inputExpand;         // INPUT_* rules expandPipeline() applies to inputText
+};
+
+// Commands joined by `|`, run as one job
+struct pipeline {
+    struct command *stages;
+    int count;               // Number of stages
+    int background;          // Followed by `&`
+    int condition;           // LIST_*: how it follows the previous pipeline
+    int timed;               // Prefixed by `time`: report how long it took
+};
+
+// Pipelines joined by `;`, `&`, `&&` and `||`, evaluated left to right
+struct commandList {
+    struct pipeline *pipelines;
+    int count;
+};
+
+// Background job (see jobs.c)
+struct job {
+    int id;                  // Job number shown as %n (slot index + 1)
+    pid_t pgid;              // Process group, led by the first stage
+    pid_t *pids;             // Pid of each stage, 0 once reaped or if it never started
+    int *statuses;           // Wait status of each stage
+    int procCount;           // Number of stages
+    int liveCount;           // Stages not reaped yet
+    int state;               // JOB_RUNNING or JOB_STOPPED
+    int parallel;            // Started by `par`, which reaps it itself
+    struct timespec start;   // CLOCK_MONOTONIC launch time
+    struct rusage usage;     // CPU time and peak RSS of the stages reaped so far
+    char *command;           // Command line, for `jobs`
+    int placedCPU;           // CPU from `set spread=cpu`, or -1
+    int placedNode;          // Node from `set spread=numa`, or -1
+    int inUse;               // Slot holds a job
+    int nextFree;            // Free-list link while the slot is unused
+};
+
+// Source of command lines (see input.c)
+struct lineReader {
+    int fd;
+    char *map;               // Whole file, if the input is a mapped regular file
+    size_t mapLen;
+    size_t pos;              // Offset of the next line in map
+    char *buffer;            // Read buffer for terminals and pipes
+    size_t cap, start, end;  // Buffer size and the unread bytes [start, end)
+};
+
+// Bump allocator, reset as a whole (see arena.c)
+struct arena {
+    struct arenaBlock *first;    // Blocks are kept across resets
+    struct arenaBlock *current;  // Block being carved
+    size_t used;                 // Bytes used in current
+};
+
+// Timings of one foreground pipeline, in microseconds (see timing.c)
+struct commandTiming {
+    double launchUs;         // Shell time spent starting the stages
+    double execUs;           // Longest start-to-exec time of a stage
+    double waitUs;           // Time blocked waiting for the stages
+    double realUs;           // Wall time from first launch to last reap
+    double userUs, sysUs;    // CPU time of the stages, from wait4()
+    long maxRssKB;           // Largest peak resident set size of a stage
+};
+
+// Per-command limits from a `limit ... --` prefix (see limits.c)
+#define LIMIT_MAX 8
+struct launchLimits {
+    int resources[LIMIT_MAX];   // RLIMIT_* to set
+    long long values[LIMIT_MAX]; // Soft limit for each
+    int rlimitCount;
+    cpu_set_t cpus;             // Affinity, if hasCpus
+    int hasCpus;
+    const char *cgroup;         // cgroup v2 directory to join, or NULL
+    int memNode;                // Preferred memory node, if hasMemNode
+    int hasMemNode;
+};
 
 // Global variables
-int foregroundOnly = 0;  // Mode toggle for foreground-only mode
-int lastExitStatus = 0;  // Stores exit status of last foreground process
-pid_t bgProcesses[50];   // Array to store background process IDs
-int bgCount = 0;         // Number of background processes
+extern int foregroundOnly;  // Mode toggle for foreground-only mode
+extern int lastExitStatus;  // Stores exit status of last foreground process
+extern int launchMode;      // Engine used by executeCommand (SMALLSH_LAUNCH)
+extern int pipefail;        // `set -o pipefail`
+extern int fastcat;         // `set -o fastcat`
+extern int tagOutput;       // `set -o tagoutput`: tag background jobs' output lines
+extern int interactive;     // Commands come from a terminal
+extern struct arena lineArena; // Storage for the line being run
+extern int timingEnabled;   // `timing on` / SMALLSH_TIMING
+extern int jobControl;      // Interactive job control: process groups and tcsetpgrp
+extern pid_t shellPgid;     // The shell's own process group
+extern int spreadMode;      // `set spread=`: SPREAD_*
+extern long long preallocBytes; // `set prealloc=SIZE`, reserved by `>!`
 
 // Function prototypes
 void prompt();
-void handle_SIGTSTP(int signo);
-void executeCommand(char *args[], int background, char *inputFile, char *outputFile);
-void checkBackgroundProcesses();
\ No newline at end of file
+void flushOutput();
+FILE *noticeOutput();
+void toggleForegroundOnly();
+int setBuiltin(char *args[]);
+long long parseSize(const char *text);
+
+// Launching (launch.c)
+void executeCommand(struct pipeline *pipeline);
+int pipelineStatus(const int *statuses, int count);
+pid_t launchCommand(struct command *cmd, int background, int inputFD, int outputFD,
+                    const struct launchLimits *placement);
+char *joinArgs(char **args);
+char *formatPipeline(struct pipeline *pipeline);
+int openOutput(const char *path, int mode);
+int openInput(struct command *cmd);
+int applyRedirections(struct command *cmd, int saved[3]);
+void restoreRedirections(int saved[3]);
+int execInPlace(struct command *cmd);
+
+// Command hash table (pathhash.c)
+const char *hashLookup(const char *name);
+void hashForget(const char *name);
+void hashClear();
+int hashBuiltin(char *args[]);
+
+// Job table (jobs.c)
+struct job *jobAdd(pid_t pgid, const pid_t *pids, const int *statuses, int count, char *command);
+struct job *jobFind(pid_t pid);
+struct job *jobGet(int id);
+void jobRemove(struct job *job);
+int jobRecordStatus(pid_t pid, int status, const struct rusage *usage, int *finalStatus);
+struct job *jobAt(int i);
+int jobSlotCount();
+int checkBackgroundProcesses(int atPrompt);
+void signalAllJobs(int signo);
+void jobControlInit();
+void giveTerminal(pid_t pgid);
+int killBuiltin(char *args[]);
+int jobsBuiltin(char *args[]);
+int fgBuiltin(char *args[]);
+int bgBuiltin(char *args[]);
+int waitBuiltin(char *args[]);
+
+// In-process cat (fastcat.c)
+int fastCat(struct command *cmd, int background);
+
+// Line input (input.c)
+void readerInit(struct lineReader *reader, int fd);
+void readerInitString(struct lineReader *reader, char *text, size_t len);
+char *readLine(struct lineReader *reader, size_t *len);
+int readerHasLine(struct lineReader *reader);
+void readerClose(struct lineReader *reader);
+void readHereDocs(struct lineReader *reader, struct pipeline *pipeline);
+void syncInputBeforeLaunch();
+void syncInputAfterWait();
+
+// Command history (history.c)
+void historyAdd(const char *line, size_t len);
+char *historyExpand(struct arena *arena, char *line, size_t *len);
+int historyBuiltin(char **args);
+
+// Shell variables and expansion (vars.c)
+extern pid_t lastBackgroundPid;
+void varsInit();
+const char *varGet(const char *name);
+int isAssignment(const char *word);
+void varAssign(const char *assignment, int export);
+void varSyncEnviron();
+int exportBuiltin(char **args);
+int unsetBuiltin(char **args);
+char *removeQuotes(struct arena *arena, char *word);
+int expandPipeline(struct arena *arena, struct pipeline *pipeline);
+
+// In-process utilities (utils.c)
+int runUtility(struct command *cmd, int background);
+
+// Command substitution (subst.c)
+const char *substitutionEnd(const char *text, const char *end);
+char *commandOutput(struct arena *arena, const char *command, size_t len, size_t *outLen);
+void runNested(const char *text, size_t len);
+extern int substitutionDepth; // `$(...)` commands running inside one another
+extern int substitutionsRun;  // `$(...)` commands run so far
+
+// Pathname expansion (glob.c)
+int globExpand(struct arena *arena, const char *pattern, char ***matches);
+
+// JSON-lines job event log (eventlog.c)
+void eventLogInit();
+void eventLogFlush();
+void eventLogJob(const char *event, const struct job *job, int status);
+
+// Arena allocator (arena.c)
+void *arenaAlloc(struct arena *arena, size_t size);
+char *arenaStrndup(struct arena *arena, const char *s, size_t len);
+void arenaReset(struct arena *arena);
+
+// Lexer and parser (parse.c)
+int lexLine(struct arena *arena, const char *line, size_t len, struct token **tokens);
+const char *parsePipeline(struct arena *arena, struct token *tokens, int count, struct pipeline *pipeline);
+const char *parseList(struct arena *arena, struct token *tokens, int count, struct commandList *list);
+
+// Launch instrumentation (timing.c)
+void timingInit();
+struct timespec *timingExecStamp(int stage);
+double elapsedUs(const struct timespec *from, const struct timespec *to);
+double timevalUs(const struct timeval *tv);
+void timingRecord(const struct commandTiming *t);
+void timeReport(const struct commandTiming *t);
+int timingBuiltin(char *args[]);
+int statsBuiltin(char *args[]);
+
+// Parallel job runner (par.c)
+int parBuiltin(char *args[]);
+
+// Event loop (events.c)
+void eventsInit(int inputFD);
+int handleSignals(int atPrompt);
+void waitForInput(struct lineReader *reader);
+pid_t waitChild(pid_t pid, int *status, int options, struct rusage *usage);
+pid_t waitChildInterruptible(pid_t pid, int *status, int options, struct rusage *usage);
+
+// Tagged job output (tagout.c)
+int tagInit();
+int tagStreamsOpen();
+int tagPipe(int fds[2]);
+void tagStreamAdd(int fd, int jobId);
+void tagFlush();
+int tagPoll(int atPrompt);
+void tagDetach();
+
+// Benchmarking (bench.c)
+void benchReport(const char *label, double *samplesUs, int count, double totalUs, const char *unit);
+int benchBuiltin(struct pipeline *pipeline);
+
+// Resource limits (limits.c)
+int ulimitBuiltin(char *args[]);
+char **parseLimits(char **args, struct launchLimits *limits);
+int applyLimits(const struct launchLimits *limits);
+int parseCPUList(const char *text, cpu_set_t *set);
+
+// Job placement (placement.c)
+int nextPlacement(struct launchLimits *limits, int *cpu, int *node);
+int preferMemoryNode(int node);
+
+// Coprocesses (coproc.c)
+int coprocBuiltin(char *args[]);
+int sendBuiltin(char *args[]);
+int recvBuiltin(char *args[]);
+void coprocCloseAll();
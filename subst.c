@@ -0,0 +1,117 @@
+/**
+ * @file subst.c
+ * @brief Command substitution: `$(command)` becomes the command's output.
+ *
+ * The command runs in the shell itself, through the same parser and
+ * launcher as any line, with stdout pointed at a `memfd` for as long as it
+ * runs. No copy of the shell is forked to run it. Once it finishes, the
+ * output is read back into the line arena in one `pread()` (the `memfd`
+ * knows its size), so a listing of any length costs no pipe-sized reads
+ * and cannot fill a pipe that nobody is reading. Trailing newlines are
+ * removed, and `expandPipeline()` splits an unquoted result into words.
+ *
+ * Builtins in the command also run in the shell, so an assignment inside
+ * `$(...)` has its usual effect. The ones that would act like a subshell's
+ * are kept local: `exit` only ends the substitution (its status becomes
+ * `$?`), the working directory is put back afterwards, and `fg`/`bg`
+ * refuse to run. Job and status notices go to stderr meanwhile (see
+ * `noticeOutput()`), so they never end up in the output.
+ */
+
+ #include "smallsh.h"
+ #include <sys/mman.h>
+ #include <sys/stat.h>
+ 
+ int substitutionDepth = 0;
+ int substitutionsRun = 0;
+ 
+ /**
+  * @brief Finds the `)` that closes a command substitution.
+  *
+  * Quotes, backslashes and nested parentheses inside the command are
+  * skipped, so `$(echo ")" $(pwd))` ends at its last `)`.
+  *
+  * @param text First byte after the `$(`.
+  * @param end End of the text to search.
+  * @return The closing `)`, or `NULL` if it is missing.
+  */
+ const char *substitutionEnd(const char *text, const char *end) {
+     int depth = 0;
+     for (const char *p = text; p < end; p++) {
+         if (*p == '\\' && p + 1 < end) {
+             p++;
+         } else if (*p == '\'') {
+             p = memchr(p + 1, '\'', end - p - 1);
+             if (!p) return NULL;
+         } else if (*p == '"') {
+             for (p++; p < end && *p != '"'; p++) {
+                 if (*p == '\\' && p + 1 < end) p++;
+                 else if (*p == '$' && p + 1 < end && p[1] == '(' && !(p = substitutionEnd(p + 2, end))) return NULL;
+             }
+             if (p == end) return NULL;
+         } else if (*p == '(') {
+             depth++;
+         } else if (*p == ')' && depth-- == 0) {
+             return p;
+         }
+     }
+     return NULL;
+ }
+ 
+ /**
+  * @brief Runs `len` bytes of command text and returns what it wrote to stdout.
+  *
+  * The shell's own stdout is set aside while the command runs and put back
+  * afterwards, so substitutions nest. `lastExitStatus` is left as the
+  * command set it.
+  *
+  * @param arena Arena for the output.
+  * @param outLen Set to the output length, without trailing newlines.
+  * @return NUL-terminated output (empty if the command could not run).
+  */
+ char *commandOutput(struct arena *arena, const char *command, size_t len, size_t *outLen) {
+     *outLen = 0;
+     int fd = memfd_create("smallsh-subst", MFD_CLOEXEC);
+     if (fd == -1) {
+         perror("memfd_create() failed");
+         return "";
+     }
+     fflush(stdout);
+     int saved = fcntl(STDOUT_FILENO, F_DUPFD_CLOEXEC, 10);
+     int cwd = open(".", O_PATH | O_DIRECTORY | O_CLOEXEC); // For a `cd` in the command
+     dup2(fd, STDOUT_FILENO);
+ 
+     substitutionDepth++;
+     substitutionsRun++;
+     runNested(command, len);
+     substitutionDepth--;
+ 
+     if (cwd != -1) {
+         if (fchdir(cwd) == -1) perror("cannot return to the working directory");
+         close(cwd);
+     }
+     fflush(stdout); // Builtins write through stdio
+     if (saved != -1) {
+         dup2(saved, STDOUT_FILENO);
+         close(saved);
+     } else if (fd != STDOUT_FILENO) {
+         close(STDOUT_FILENO); // There was no stdout to begin with
+     }
+ 
+     struct stat st;
+     size_t size = fstat(fd, &st) == 0 ? (size_t)st.st_size : 0;
+     char *output = arenaAlloc(arena, size + 1);
+     size_t done = 0;
+     while (done < size) {
+         ssize_t n = pread(fd, output + done, size - done, done);
+         if (n == -1 && errno == EINTR) continue;
+         if (n <= 0) break;
+         done += n;
+     }
+     close(fd);
+ 
+     while (done > 0 && output[done - 1] == '\n') done--;
+     output[done] = '\0';
+     *outLen = done;
+     return output;
+ }
@@ -0,0 +1,218 @@
+/**
+ * @file tagout.c
+ * @brief Tagged output for background jobs (`set -o tagoutput`).
+ *
+ * With the option on, each background job gets one pipe for the stdout of
+ * its last stage and the stderr of every stage (unless redirected). The
+ * shell reads the pipes with large nonblocking reads between commands, at
+ * the prompt and while it waits for a child (see events.c), and writes out
+ * whole lines, each tagged with the job number:
+ *
+ *     [1] compiling a.c
+ *     [2] fetching index
+ *
+ * A line is only written once its newline arrives (until then it is held
+ * for its job), so lines from parallel jobs never interleave. Completed
+ * lines from all jobs collect in one shared buffer written with a single
+ * `write()` per round of reading. The pipes are enlarged to TAG_PIPE_SIZE
+ * so a fast producer rarely has to wait for the shell. When the shell
+ * exits with tagged jobs still running, a child of it takes over the
+ * pipes (see `tagDetach()`), so their output outlives the shell as an
+ * untagged job's would.
+ */
+
+ #include "smallsh.h"
+ #include <sys/epoll.h>
+ 
+ #define TAG_READ 65536            // Bytes per read()
+ #define TAG_READS_PER_ROUND 16    // Then the other streams get a turn
+ #define TAG_BUFFER 262144         // Shared buffer of completed lines
+ #define TAG_LINE_MAX 65536        // A longer line is cut and written in pieces
+ #define TAG_PIPE_SIZE (1 << 20)   // Requested pipe capacity
+ 
+ // One job's output pipe
+ struct tagStream {
+     int fd;
+     int jobId;
+     char *partial;               // Line whose newline has not arrived yet
+     size_t partialLen, partialCap;
+ };
+ 
+ int tagOutput = 0;
+ static int tagEpollFD = -1;      // Watches every open stream
+ static int streamCount = 0;
+ static char outBuffer[TAG_BUFFER];
+ static size_t outUsed = 0;
+ static int startLine = 0;        // Move past the prompt before the next write
+ static int flushed = 0;          // Something was written since tagPoll() started
+ 
+ /**
+  * @brief Creates the epoll set of streams, which the event loop watches as one descriptor.
+  */
+ int tagInit() {
+     tagEpollFD = epoll_create1(EPOLL_CLOEXEC);
+     return tagEpollFD;
+ }
+ 
+ /**
+  * @brief Returns whether any job output pipe is still open.
+  */
+ int tagStreamsOpen() {
+     return streamCount > 0;
+ }
+ 
+ /**
+  * @brief Creates a job's output pipe: `fds[1]` for the job, `fds[0]` for `tagStreamAdd()`.
+  *
+  * @return `0`, or `-1` after printing an error.
+  */
+ int tagPipe(int fds[2]) {
+     if (pipe2(fds, O_CLOEXEC) == -1) {
+         perror("pipe() failed");
+         return -1;
+     }
+     fcntl(fds[1], F_SETPIPE_SZ, TAG_PIPE_SIZE); // Best effort: the limit may be lower
+     fcntl(fds[0], F_SETFL, O_NONBLOCK);
+     return 0;
+ }
+ 
+ /**
+  * @brief Starts reading a job's output pipe; the stream closes itself at EOF.
+  */
+ void tagStreamAdd(int fd, int jobId) {
+     struct tagStream *stream = calloc(1, sizeof *stream);
+     stream->fd = fd;
+     stream->jobId = jobId;
+ 
+     struct epoll_event event = { .events = EPOLLIN, .data.ptr = stream };
+     if (tagEpollFD == -1 || epoll_ctl(tagEpollFD, EPOLL_CTL_ADD, fd, &event) == -1) {
+         close(fd);
+         free(stream);
+         return;
+     }
+     streamCount++;
+ }
+ 
+ /**
+  * @brief Writes out the completed lines.
+  */
+ void tagFlush() {
+     if (outUsed == 0) return;
+     if (startLine) putchar('\n');
+     startLine = 0;
+     fflush(stdout); // Keep the shell's own output in order
+     for (size_t done = 0; done < outUsed; ) {
+         ssize_t n = write(STDOUT_FILENO, outBuffer + done, outUsed - done);
+         if (n == -1 && errno == EINTR) continue;
+         if (n <= 0) break; // Nowhere to write: drop the rest
+         done += n;
+     }
+     outUsed = 0;
+     flushed = 1;
+ }
+ 
+ /**
+  * @brief Adds one tagged line to the shared buffer: the held partial line, then `len` bytes of `text`.
+  */
+ static void emitLine(struct tagStream *stream, const char *text, size_t len) {
+     size_t needed = 16 + stream->partialLen + len;
+     if (outUsed + needed > sizeof outBuffer) tagFlush();
+     outUsed += sprintf(outBuffer + outUsed, "[%d] ", stream->jobId);
+     memcpy(outBuffer + outUsed, stream->partial, stream->partialLen);
+     outUsed += stream->partialLen;
+     memcpy(outBuffer + outUsed, text, len);
+     outUsed += len;
+     outBuffer[outUsed++] = '\n';
+     stream->partialLen = 0;
+ }
+ 
+ /**
+  * @brief Splits freshly read bytes into lines, holding back an unfinished last line.
+  */
+ static void addOutput(struct tagStream *stream, const char *data, size_t len) {
+     const char *end = data + len, *newline;
+     while (data < end && (newline = memchr(data, '\n', end - data))) {
+         emitLine(stream, data, newline - data);
+         data = newline + 1;
+     }
+     while (data < end) {
+         size_t take = end - data;
+         if (take > TAG_LINE_MAX - stream->partialLen) take = TAG_LINE_MAX - stream->partialLen;
+         if (stream->partialLen + take > stream->partialCap) {
+             stream->partialCap = stream->partialLen + take > 4096 ? TAG_LINE_MAX : 4096;
+             stream->partial = realloc(stream->partial, stream->partialCap);
+         }
+         memcpy(stream->partial + stream->partialLen, data, take);
+         stream->partialLen += take;
+         data += take;
+         if (stream->partialLen == TAG_LINE_MAX) emitLine(stream, "", 0);
+     }
+ }
+ 
+ /**
+  * @brief Reads what a stream has ready, closing it at EOF.
+  */
+ static void drainStream(struct tagStream *stream) {
+     static char chunk[TAG_READ];
+     for (int reads = 0; reads < TAG_READS_PER_ROUND; reads++) {
+         ssize_t n = read(stream->fd, chunk, sizeof chunk);
+         if (n > 0) {
+             addOutput(stream, chunk, n);
+             continue;
+         }
+         if (n == -1 && errno == EINTR) continue;
+         if (n == -1 && errno == EAGAIN) return;
+ 
+         // EOF (or a dead pipe): finish the last line and let the stream go
+         if (stream->partialLen > 0) emitLine(stream, "", 0);
+         epoll_ctl(tagEpollFD, EPOLL_CTL_DEL, stream->fd, NULL);
+         close(stream->fd);
+         free(stream->partial);
+         free(stream);
+         streamCount--;
+         return;
+     }
+ }
+ 
+ /**
+  * @brief Copies out whatever the job output pipes have ready, without blocking.
+  *
+  * @param atPrompt Start on a new line, past the prompt.
+  * @return Nonzero if anything was written.
+  */
+ int tagPoll(int atPrompt) {
+     struct epoll_event events[16];
+     int n, rounds = 0;
+ 
+     if (streamCount == 0) return 0;
+     startLine = atPrompt;
+     flushed = 0;
+     while (rounds++ < 4 && (n = epoll_wait(tagEpollFD, events, 16, 0)) > 0) {
+         for (int i = 0; i < n; i++) drainStream(events[i].data.ptr);
+     }
+     tagFlush();
+     startLine = 0;
+     return flushed;
+ }
+ 
+ /**
+  * @brief Hands the open job output pipes to a child that copies them until every job closes its pipe.
+  *
+  * Called as the shell exits. The child writes to the shell's stdout in the
+  * usual tagged form, and the shell itself exits without waiting for it.
+  */
+ void tagDetach() {
+     tagPoll(0);
+     if (streamCount == 0) return;
+     fflush(stdout);
+     pid_t pid = fork();
+     if (pid == -1) perror("fork() failed");
+     if (pid != 0) return;
+ 
+     while (streamCount > 0) {
+         struct epoll_event event;
+         if (epoll_wait(tagEpollFD, &event, 1, -1) == -1 && errno != EINTR) break;
+         tagPoll(0);
+     }
+     _exit(0);
+ }
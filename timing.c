@@ -0,0 +1,185 @@
+/**
+ * @file timing.c
+ * @brief Optional launch latency instrumentation for smallsh.
+ *
+ * When enabled (`SMALLSH_TIMING=1` or `timing on`), every foreground
+ * pipeline reports how long the shell spent launching it, how long the
+ * child took to reach `exec`, the time spent waiting, and the user/sys
+ * time from `wait4()`. The samples also go into log-linear histograms
+ * that the `stats` builtin summarizes as percentiles.
+ */
+
+ #include "smallsh.h"
+ #include <math.h>
+ #include <sys/mman.h>
+ 
+ #define HIST_SUB 16                  // Sub-buckets per power of two (~6% resolution)
+ #define HIST_BUCKETS (48 * HIST_SUB) // Covers 1us to ~9 years
+ #define EXEC_STAMPS 64               // Stages per pipeline with their own exec stamp
+ 
+ struct histogram {
+     const char *name;
+     unsigned long counts[HIST_BUCKETS];
+     unsigned long total;
+     double min, max;                 // Microseconds
+ };
+ 
+ int timingEnabled = 0;
+ 
+ static struct histogram histograms[] = {
+     { "real" }, { "launch" }, { "exec" }, { "wait" }, { "user" }, { "sys" },
+ };
+ static const int histogramCount = sizeof histograms / sizeof histograms[0];
+ 
+ // Shared with forked children, which stamp the moment they call exec
+ static struct timespec *execStamps = NULL;
+ 
+ /**
+  * @brief Turns instrumentation on if `SMALLSH_TIMING` is set to anything but `0`.
+  */
+ void timingInit() {
+     const char *value = getenv("SMALLSH_TIMING");
+     if (value && *value && strcmp(value, "0") != 0) timingEnabled = 1;
+ }
+ 
+ /**
+  * @brief Returns where forked stage `stage` should stamp its exec time, or `NULL`.
+  */
+ struct timespec *timingExecStamp(int stage) {
+     if (!timingEnabled) return NULL;
+     if (!execStamps) {
+         execStamps = mmap(NULL, EXEC_STAMPS * sizeof *execStamps, PROT_READ | PROT_WRITE,
+                           MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+         if (execStamps == MAP_FAILED) {
+             execStamps = NULL;
+             return NULL;
+         }
+     }
+     return &execStamps[stage % EXEC_STAMPS];
+ }
+ 
+ /**
+  * @brief Microseconds from `from` to `to`.
+  */
+ double elapsedUs(const struct timespec *from, const struct timespec *to) {
+     return (to->tv_sec - from->tv_sec) * 1e6 + (to->tv_nsec - from->tv_nsec) / 1e3;
+ }
+ 
+ /**
+  * @brief Converts a `struct timeval` from rusage to microseconds.
+  */
+ double timevalUs(const struct timeval *tv) {
+     return tv->tv_sec * 1e6 + tv->tv_usec;
+ }
+ 
+ /**
+  * @brief Maps a sample to its bucket: power of two, then linear within it.
+  */
+ static int bucketFor(double us) {
+     if (us < 1) return 0;
+     int exp;
+     double frac = frexp(us, &exp); // us = frac * 2^exp, frac in [0.5, 1)
+     int bucket = (exp - 1) * HIST_SUB + (int)((frac * 2 - 1) * HIST_SUB);
+     return bucket < HIST_BUCKETS ? bucket : HIST_BUCKETS - 1;
+ }
+ 
+ /**
+  * @brief Upper bound, in microseconds, of the values in `bucket`.
+  */
+ static double bucketLimit(int bucket) {
+     return ldexp(1 + (bucket % HIST_SUB + 1) / (double)HIST_SUB, bucket / HIST_SUB);
+ }
+ 
+ static void histogramAdd(struct histogram *h, double us) {
+     if (h->total == 0 || us < h->min) h->min = us;
+     if (h->total == 0 || us > h->max) h->max = us;
+     h->counts[bucketFor(us)]++;
+     h->total++;
+ }
+ 
+ /**
+  * @brief Returns the `p`th percentile (0-100), clamped to the observed range.
+  */
+ static double histogramPercentile(const struct histogram *h, double p) {
+     unsigned long rank = (unsigned long)ceil(h->total * p / 100);
+     unsigned long seen = 0;
+ 
+     if (rank == 0) rank = 1;
+     for (int i = 0; i < HIST_BUCKETS; i++) {
+         seen += h->counts[i];
+         if (seen >= rank) {
+             double limit = bucketLimit(i);
+             if (limit > h->max) limit = h->max;
+             if (limit < h->min) limit = h->min;
+             return limit;
+         }
+     }
+     return h->max;
+ }
+ 
+ /**
+  * @brief Prints one command's timings to stderr and adds them to the histograms.
+  */
+ void timingRecord(const struct commandTiming *t) {
+     double samples[] = { t->realUs, t->launchUs, t->execUs, t->waitUs, t->userUs, t->sysUs };
+ 
+     fprintf(stderr, "timing: real %.3fms launch %.3fms exec %.3fms wait %.3fms user %.3fms sys %.3fms\n",
+             t->realUs / 1e3, t->launchUs / 1e3, t->execUs / 1e3, t->waitUs / 1e3,
+             t->userUs / 1e3, t->sysUs / 1e3);
+     for (int i = 0; i < histogramCount; i++) histogramAdd(&histograms[i], samples[i]);
+ }
+ 
+ /**
+  * @brief Prints the report for a command run as `time command`, to stderr.
+  */
+ void timeReport(const struct commandTiming *t) {
+     fprintf(stderr, "real %.3fs user %.3fs sys %.3fs maxrss %ldKB\n",
+             t->realUs / 1e6, t->userUs / 1e6, t->sysUs / 1e6, t->maxRssKB);
+ }
+ 
+ /**
+  * @brief Built-in `timing [on|off]`: toggles instrumentation or shows its state.
+  */
+ int timingBuiltin(char *args[]) {
+     if (!args[1]) {
+         printf("timing %s\n", timingEnabled ? "on" : "off");
+         flushOutput();
+         return 0;
+     }
+     if (strcmp(args[1], "on") == 0) {
+         timingEnabled = 1;
+     } else if (strcmp(args[1], "off") == 0) {
+         timingEnabled = 0;
+     } else {
+         fprintf(stderr, "timing: usage: timing [on|off]\n");
+         return 1;
+     }
+     return 0;
+ }
+ 
+ /**
+  * @brief Built-in `stats [-r]`: prints count/min/p50/p99/max per metric, or resets them.
+  */
+ int statsBuiltin(char *args[]) {
+     if (args[1] && strcmp(args[1], "-r") == 0) {
+         for (int i = 0; i < histogramCount; i++) {
+             const char *name = histograms[i].name;
+             memset(&histograms[i], 0, sizeof histograms[i]);
+             histograms[i].name = name;
+         }
+         return 0;
+     }
+ 
+     printf("%-8s %10s %10s %10s %10s %10s  (ms)\n", "", "count", "min", "p50", "p99", "max");
+     for (int i = 0; i < histogramCount; i++) {
+         const struct histogram *h = &histograms[i];
+         if (h->total == 0) {
+             printf("%-8s %10d\n", h->name, 0);
+             continue;
+         }
+         printf("%-8s %10lu %10.3f %10.3f %10.3f %10.3f\n", h->name, h->total, h->min / 1e3,
+                histogramPercentile(h, 50) / 1e3, histogramPercentile(h, 99) / 1e3, h->max / 1e3);
+     }
+     flushOutput();
+     return 0;
+ }
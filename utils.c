@@ -0,0 +1,465 @@
+/**
+ * @file utils.c
+ * @brief In-process `echo`, `printf`, `test`/`[`, `true` and `false`.
+ *
+ * Control scripts run these far more often than anything else, so the
+ * shell runs them itself instead of launching `/bin/echo` or
+ * `/usr/bin/test`. Redirections still apply: the shell's own descriptors
+ * are pointed at the targets for the duration of the utility and then put
+ * back (see `applyRedirections()`). Output goes through stdio, so a run
+ * of `echo` lines to a file or pipe costs one `write()` per buffer rather
+ * than one process each. Only a foreground command on its own is run here;
+ * pipeline stages and `&` commands still launch the external utility.
+ */
+
+ #include "smallsh.h"
+ #include <ctype.h>
+ #include <sys/stat.h>
+ 
+ /**
+  * @brief Prints `text` with backslash escapes interpreted, as `echo -e` and `printf` do.
+  *
+  * @param octalZero Octal escapes are `\0nnn` (`echo -e`, `%b`) rather than `\nnn` (a `printf` format).
+  * @param len Set to the number of bytes of `text` used, up to the first `%`
+  *            if `stopAtPercent`; may be `NULL`.
+  * @return `1` if a `\c` asked for all further output to be suppressed, else `0`.
+  */
+ static int putEscaped(const char *text, int octalZero, int stopAtPercent, size_t *len) {
+     const char *p = text;
+     while (*p && !(stopAtPercent && *p == '%')) {
+         if (*p != '\\' || !p[1]) {
+             putchar(*p++);
+             continue;
+         }
+         p++;
+         char c = *p++;
+         int value = 0, digits = 0;
+         switch (c) {
+         case 'a': putchar('\a'); break;
+         case 'b': putchar('\b'); break;
+         case 'e': putchar('\033'); break;
+         case 'f': putchar('\f'); break;
+         case 'n': putchar('\n'); break;
+         case 'r': putchar('\r'); break;
+         case 't': putchar('\t'); break;
+         case 'v': putchar('\v'); break;
+         case '\\': putchar('\\'); break;
+         case 'c':
+             if (len) *len = p - text;
+             return 1;
+         case 'x':
+             while (digits < 2 && isxdigit((unsigned char)*p)) {
+                 value = value * 16 + (isdigit((unsigned char)*p) ? *p - '0' : tolower((unsigned char)*p) - 'a' + 10);
+                 p++, digits++;
+             }
+             if (digits) putchar(value);
+             else fputs("\\x", stdout);
+             break;
+         default:
+             if (c >= '0' && c <= '7' && (c != '0' || !octalZero)) {
+                 p--; // A `printf` format escape: the digits start here
+             } else if (c != '0') {
+                 putchar('\\');
+                 putchar(c);
+                 break;
+             }
+             while (digits < 3 && *p >= '0' && *p <= '7') value = value * 8 + (*p++ - '0'), digits++;
+             putchar(value);
+             break;
+         }
+     }
+     if (len) *len = p - text;
+     return 0;
+ }
+ 
+ /**
+  * @brief `echo [-neE] [arg ...]`: prints the arguments separated by spaces.
+  *
+  * `-n` leaves out the newline, `-e` interprets backslash escapes and `-E`
+  * (the default) does not, as in bash.
+  */
+ static int echoUtility(char **args) {
+     int newline = 1, escapes = 0, i = 1;
+     for (; args[i] && args[i][0] == '-' && args[i][1] && strspn(args[i] + 1, "neE") == strlen(args[i] + 1); i++) {
+         for (const char *flag = args[i] + 1; *flag; flag++) {
+             if (*flag == 'n') newline = 0;
+             else escapes = *flag == 'e';
+         }
+     }
+     for (int first = i; args[i]; i++) {
+         if (i > first) putchar(' ');
+         if (!escapes) fputs(args[i], stdout);
+         else if (putEscaped(args[i], 1, 0, NULL)) return 0;
+     }
+     if (newline) putchar('\n');
+     return 0;
+ }
+ 
+ /**
+  * @brief Converts a `printf` numeric argument; `'c` or `"c` gives the character's code.
+  *
+  * @param status Set to `1` after a warning if `arg` is not entirely a number.
+  */
+ static long long numberArg(const char *arg, int *status) {
+     if (!arg) return 0;
+     if ((arg[0] == '\'' || arg[0] == '"') && arg[1]) return (unsigned char)arg[1];
+     char *end;
+     errno = 0;
+     long long value = strtoll(arg, &end, 0);
+     if (end == arg || *end || errno) {
+         fprintf(stderr, "printf: %s: invalid number\n", arg);
+         *status = 1;
+     }
+     return value;
+ }
+ 
+ static double floatArg(const char *arg, int *status) {
+     if (!arg) return 0;
+     if ((arg[0] == '\'' || arg[0] == '"') && arg[1]) return (unsigned char)arg[1];
+     char *end;
+     double value = strtod(arg, &end);
+     if (end == arg || *end) {
+         fprintf(stderr, "printf: %s: invalid number\n", arg);
+         *status = 1;
+     }
+     return value;
+ }
+ 
+ /**
+  * @brief `printf format [arg ...]`: formatted output.
+  *
+  * Supports the flags, field widths and precisions (including `*`) of
+  * C's `printf` with the conversions `diouxXcs` and `eEfFgGaA`, `%b` for
+  * an argument with `echo -e` escapes and `%%`. The format is reused until
+  * every argument is consumed; missing arguments read as empty or zero.
+  */
+ static int printfUtility(char **args) {
+     if (!args[1]) {
+         fprintf(stderr, "printf: usage: printf format [arguments]\n");
+         return 2;
+     }
+     const char *format = args[1];
+     char **next = &args[2];
+     int status = 0;
+ 
+     do {
+         char **start = next;
+         for (const char *p = format; *p; ) {
+             size_t used;
+             if (*p != '%') {
+                 if (putEscaped(p, 0, 1, &used)) return status;
+                 p += used;
+                 continue;
+             }
+             if (p[1] == '%') {
+                 putchar('%');
+                 p += 2;
+                 continue;
+             }
+ 
+             // Copy the spec, resolving `*` widths, then print with the matching C type
+             char spec[64];
+             size_t len = 0;
+             spec[len++] = *p++;
+             while (*p && strchr("-+ #0", *p) && len < 16) spec[len++] = *p++;
+             for (int part = 0; part < 2; part++) {
+                 if (part == 1) {
+                     if (*p != '.') break;
+                     spec[len++] = *p++;
+                 }
+                 if (*p == '*') {
+                     len += snprintf(spec + len, 24, "%d", (int)numberArg(*next, &status));
+                     if (*next) next++;
+                     p++;
+                 } else {
+                     while (isdigit((unsigned char)*p) && len < 40) spec[len++] = *p++;
+                 }
+             }
+             char conversion = *p;
+             if (!conversion) {
+                 fprintf(stderr, "printf: %s: missing conversion\n", format);
+                 return 1;
+             }
+             p++;
+             const char *arg = *next;
+             if (arg) next++;
+ 
+             if (strchr("diouxX", conversion)) {
+                 spec[len++] = 'l';
+                 spec[len++] = 'l';
+                 spec[len++] = conversion;
+                 spec[len] = '\0';
+                 long long value = numberArg(arg, &status);
+                 if (conversion == 'd' || conversion == 'i') printf(spec, value);
+                 else printf(spec, (unsigned long long)value);
+             } else if (strchr("eEfFgGaA", conversion)) {
+                 spec[len++] = conversion;
+                 spec[len] = '\0';
+                 printf(spec, floatArg(arg, &status));
+             } else if (conversion == 'c' || conversion == 's') {
+                 spec[len++] = conversion;
+                 spec[len] = '\0';
+                 if (conversion == 'c' && !(arg && arg[0])) spec[len - 1] = 's'; // Nothing to print but padding
+                 if (spec[len - 1] == 'c') printf(spec, arg[0]);
+                 else printf(spec, arg ? arg : "");
+             } else if (conversion == 'b') {
+                 if (arg && putEscaped(arg, 1, 0, NULL)) return status;
+             } else {
+                 fprintf(stderr, "printf: %%%c: invalid conversion\n", conversion);
+                 return 1;
+             }
+         }
+         if (next == start) break; // The format takes no arguments
+     } while (*next);
+     return status;
+ }
+ 
+ // Cursor over the expression of one `test` (an error sets `error`)
+ struct testParser {
+     char **args;
+     int count, pos, error;
+ };
+ 
+ static int isUnaryTest(const char *op) {
+     return op[0] == '-' && op[1] && !op[2] && strchr("bcdefghkLnprsStuwxzOG", op[1]);
+ }
+ 
+ static int isBinaryTest(const char *op) {
+     static const char *ops[] = {
+         "=", "==", "!=", "<", ">", "-eq", "-ne", "-lt", "-le", "-gt", "-ge", "-nt", "-ot", "-ef",
+     };
+     for (size_t i = 0; i < sizeof ops / sizeof ops[0]; i++) {
+         if (strcmp(op, ops[i]) == 0) return 1;
+     }
+     return 0;
+ }
+ 
+ static void testError(struct testParser *t, const char *arg, const char *message) {
+     if (!t->error) fprintf(stderr, "test: %s%s%s\n", arg ? arg : "", arg ? ": " : "", message);
+     t->error = 1;
+ }
+ 
+ /**
+  * @brief Evaluates a one-operand test such as `-f path` or `-z string`.
+  */
+ static int unaryTest(struct testParser *t, const char *op, const char *arg) {
+     struct stat st;
+     switch (op[1]) {
+     case 'n': return arg[0] != '\0';
+     case 'z': return arg[0] == '\0';
+     case 't': return isatty(atoi(arg));
+     case 'r': return access(arg, R_OK) == 0;
+     case 'w': return access(arg, W_OK) == 0;
+     case 'x': return access(arg, X_OK) == 0;
+     case 'h':
+     case 'L': return lstat(arg, &st) == 0 && S_ISLNK(st.st_mode);
+     }
+     if (stat(arg, &st) == -1) return 0;
+     switch (op[1]) {
+     case 'e': return 1;
+     case 'f': return S_ISREG(st.st_mode);
+     case 'd': return S_ISDIR(st.st_mode);
+     case 'b': return S_ISBLK(st.st_mode);
+     case 'c': return S_ISCHR(st.st_mode);
+     case 'p': return S_ISFIFO(st.st_mode);
+     case 'S': return S_ISSOCK(st.st_mode);
+     case 's': return st.st_size > 0;
+     case 'g': return (st.st_mode & S_ISGID) != 0;
+     case 'u': return (st.st_mode & S_ISUID) != 0;
+     case 'k': return (st.st_mode & S_ISVTX) != 0;
+     case 'O': return st.st_uid == geteuid();
+     case 'G': return st.st_gid == getegid();
+     }
+     testError(t, op, "unary operator expected");
+     return 0;
+ }
+ 
+ /**
+  * @brief Parses an integer operand of `-eq` and friends.
+  */
+ static long long integerOperand(struct testParser *t, const char *arg) {
+     char *end;
+     errno = 0;
+     long long value = strtoll(arg, &end, 10);
+     while (*end == ' ' || *end == '\t') end++;
+     if (end == arg || *end || errno) testError(t, arg, "integer expression expected");
+     return value;
+ }
+ 
+ /**
+  * @brief Evaluates a two-operand test such as `a = b` or `f1 -nt f2`.
+  */
+ static int binaryTest(struct testParser *t, const char *left, const char *op, const char *right) {
+     if (op[0] != '-') {
+         int order = strcmp(left, right);
+         if (op[0] == '<') return order < 0;
+         if (op[0] == '>') return order > 0;
+         return op[0] == '!' ? order != 0 : order == 0;
+     }
+     if (op[1] == 'n' || op[1] == 'o' || (op[1] == 'e' && op[2] == 'f')) {
+         struct stat a, b;
+         int haveA = stat(left, &a) == 0, haveB = stat(right, &b) == 0;
+         if (op[1] == 'e') return haveA && haveB && a.st_dev == b.st_dev && a.st_ino == b.st_ino;
+         if (!haveA || !haveB) return op[1] == 'n' ? haveA : haveB; // A missing file is older than any
+         double newer = (a.st_mtim.tv_sec - b.st_mtim.tv_sec) + (a.st_mtim.tv_nsec - b.st_mtim.tv_nsec) / 1e9;
+         return op[1] == 'n' ? newer > 0 : newer < 0;
+     }
+     long long l = integerOperand(t, left), r = integerOperand(t, right);
+     if (strcmp(op, "-eq") == 0) return l == r;
+     if (strcmp(op, "-ne") == 0) return l != r;
+     if (strcmp(op, "-lt") == 0) return l < r;
+     if (strcmp(op, "-le") == 0) return l <= r;
+     if (strcmp(op, "-gt") == 0) return l > r;
+     return l >= r;
+ }
+ 
+ static int testOr(struct testParser *t);
+ 
+ /**
+  * @brief `( expr )`, a unary or binary test, or a lone string (true if non-empty).
+  */
+ static int testPrimary(struct testParser *t) {
+     char **a = t->args + t->pos;
+     int left = t->count - t->pos;
+ 
+     if (left == 0) {
+         testError(t, NULL, "argument expected");
+         return 0;
+     }
+     if (left >= 3 && isBinaryTest(a[1])) {
+         t->pos += 3;
+         return binaryTest(t, a[0], a[1], a[2]);
+     }
+     if (strcmp(a[0], "(") == 0) {
+         t->pos++;
+         int value = testOr(t);
+         if (t->pos >= t->count || strcmp(t->args[t->pos], ")") != 0) testError(t, NULL, "`)' expected");
+         t->pos++;
+         return value;
+     }
+     if (left >= 2 && isUnaryTest(a[0])) {
+         t->pos += 2;
+         return unaryTest(t, a[0], a[1]);
+     }
+     t->pos++;
+     return a[0][0] != '\0';
+ }
+ 
+ static int testNot(struct testParser *t) {
+     if (t->pos < t->count && strcmp(t->args[t->pos], "!") == 0) {
+         t->pos++;
+         return !testNot(t);
+     }
+     return testPrimary(t);
+ }
+ 
+ static int testAnd(struct testParser *t) {
+     int value = testNot(t);
+     while (t->pos < t->count && strcmp(t->args[t->pos], "-a") == 0) {
+         t->pos++;
+         value = testNot(t) && value;
+     }
+     return value;
+ }
+ 
+ static int testOr(struct testParser *t) {
+     int value = testAnd(t);
+     while (t->pos < t->count && strcmp(t->args[t->pos], "-o") == 0) {
+         t->pos++;
+         value = testAnd(t) || value;
+     }
+     return value;
+ }
+ 
+ /**
+  * @brief Evaluates `count` test arguments: POSIX's rules for up to four, then a full parse.
+  */
+ static int testEvaluate(struct testParser *t, char **args, int count) {
+     char *op = count > 1 ? args[1] : NULL;
+     switch (count) {
+     case 0: return 0;
+     case 1: return args[0][0] != '\0';
+     case 2:
+         if (strcmp(args[0], "!") == 0) return args[1][0] == '\0';
+         if (isUnaryTest(args[0])) return unaryTest(t, args[0], args[1]);
+         testError(t, args[0], "unary operator expected");
+         return 0;
+     case 3:
+         if (isBinaryTest(op)) return binaryTest(t, args[0], op, args[2]);
+         if (strcmp(args[0], "!") == 0) return !testEvaluate(t, args + 1, 2);
+         if (strcmp(args[0], "(") == 0 && strcmp(args[2], ")") == 0) return args[1][0] != '\0';
+         break;
+     case 4:
+         if (strcmp(args[0], "!") == 0) return !testEvaluate(t, args + 1, 3);
+         if (strcmp(args[0], "(") == 0 && strcmp(args[3], ")") == 0) return testEvaluate(t, args + 1, 2);
+         break;
+     }
+     t->args = args;
+     t->count = count;
+     t->pos = 0;
+     int value = testOr(t);
+     if (t->pos < t->count) testError(t, t->args[t->pos], "too many arguments");
+     return value;
+ }
+ 
+ /**
+  * @brief `test expr` and `[ expr ]`: exit value 0 if true, 1 if false, 2 on error.
+  */
+ static int testUtility(char **args) {
+     int count = 0;
+     while (args[count + 1]) count++;
+     if (strcmp(args[0], "[") == 0) {
+         if (count == 0 || strcmp(args[count], "]") != 0) {
+             fprintf(stderr, "[: missing `]'\n");
+             return 2;
+         }
+         count--;
+     }
+     struct testParser t = {0};
+     int value = testEvaluate(&t, args + 1, count);
+     return t.error ? 2 : !value;
+ }
+ 
+ static int trueUtility(char **args) {
+     (void)args;
+     return 0;
+ }
+ 
+ static int falseUtility(char **args) {
+     (void)args;
+     return 1;
+ }
+ 
+ static const struct {
+     const char *name;
+     int (*run)(char **args);
+ } utilities[] = {
+     { "echo", echoUtility },
+     { "printf", printfUtility },
+     { "test", testUtility },
+     { "[", testUtility },
+     { "true", trueUtility },
+     { "false", falseUtility },
+ };
+ 
+ /**
+  * @brief Runs `cmd` in the shell if it is one of the utilities here.
+  *
+  * @param background The command was started with `&`; such commands are
+  *                   left to the launcher.
+  * @return The utility's exit value, or `-1` if `cmd` is not run here.
+  */
+ int runUtility(struct command *cmd, int background) {
+     int (*run)(char **args) = NULL;
+     for (size_t i = 0; i < sizeof utilities / sizeof utilities[0]; i++) {
+         if (strcmp(cmd->args[0], utilities[i].name) == 0) run = utilities[i].run;
+     }
+     if (!run || (background && !foregroundOnly)) return -1;
+ 
+     int saved[3];
+     if (applyRedirections(cmd, saved) == -1) return 1;
+     int status = run(cmd->args);
+     restoreRedirections(saved);
+     flushOutput();
+     return status;
+ }
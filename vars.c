@@ -0,0 +1,596 @@
+/**
+ * @file vars.c
+ * @brief Shell variables, the exported environment and `$` expansion.
+ *
+ *     NAME=value ...          set shell variables
+ *     export NAME[=value] ... pass variables to later commands
+ *     unset NAME ...          remove variables
+ *     $NAME ${NAME} $$ $? $!  expand in words, redirections and here-docs
+ *     $(command)              expands to the command's output (see subst.c)
+ *
+ * Variables live in a hash table seeded from the shell's environment,
+ * which doubles whenever it holds more variables than buckets.
+ * Each entry keeps its `NAME=value` string, so the `environ` array handed
+ * to `posix_spawn()` and `execve()` is only pointers to them; it is rebuilt
+ * right before a launch, and only when an exported variable changed since
+ * the last one. The old string of a changed or unset exported variable is
+ * kept until that rebuild, so `environ` (and `getenv()`) never points at
+ * freed memory. Expansion runs on each pipeline just before it starts, so
+ * `false; echo $?` sees the status of `false`. Expanded variables are not
+ * split into words, and an unquoted expansion that comes out empty drops
+ * the word. An unquoted `$(...)` in an argument is split at blanks and
+ * newlines; its output is never glob-expanded.
+ */
+
+ #include "smallsh.h"
+ 
+ #define VAR_BUCKETS 256          // Initial table size, a power of two
+ #define RETIRED_MAX 64           // Old exported strings held before environ is rebuilt early
+ 
+ // expandText() rules
+ #define EXPAND_WORD 0            // Quotes, backslashes and `$`, as in arguments
+ #define EXPAND_QUOTES 1          // Quote removal only, for here-doc delimiters
+ #define EXPAND_HEREDOC 2         // `$` and `\$`; quotes are literal
+ 
+ struct var {
+     char *name;
+     char *pair;              // "NAME=value"; the value starts after the `=`
+     int exported;            // Part of the environment of launched commands
+     struct var *next;        // Next variable in the same bucket
+ };
+ 
+ pid_t lastBackgroundPid = 0;   // For `$!`
+ 
+ static struct var **varTable = NULL;
+ static unsigned varBuckets = 0;
+ static int varCount = 0;
+ static int environDirty = 0;   // An exported variable changed since environ was built
+ static char **builtEnviron = NULL;
+ static char *retired[RETIRED_MAX]; // Old "NAME=value" strings environ may still point at
+ static int retiredCount = 0;
+ static pid_t shellPid;
+ 
+ /**
+  * @brief FNV-1a hash of the first `len` bytes of a variable name.
+  *
+  * Callers take it modulo the table size.
+  */
+ static unsigned hashVar(const char *name, size_t len) {
+     unsigned h = 2166136261u;
+     for (size_t i = 0; i < len; i++) {
+         h ^= (unsigned char)name[i];
+         h *= 16777619u;
+     }
+     return h;
+ }
+ 
+ /**
+  * @brief Finds a variable by the first `len` bytes of `name`.
+  */
+ static struct var *varFind(const char *name, size_t len) {
+     if (!varTable) return NULL;
+     for (struct var *v = varTable[hashVar(name, len) & (varBuckets - 1)]; v; v = v->next) {
+         if (strncmp(v->name, name, len) == 0 && v->name[len] == '\0') return v;
+     }
+     return NULL;
+ }
+ 
+ /**
+  * @brief Length of the variable name at the start of `text` (`0` if none).
+  */
+ static size_t nameLength(const char *text) {
+     size_t len = 0;
+     if (!(text[0] == '_' || (text[0] >= 'a' && text[0] <= 'z') || (text[0] >= 'A' && text[0] <= 'Z'))) return 0;
+     while (text[len] == '_' || (text[len] >= 'a' && text[len] <= 'z') || (text[len] >= 'A' && text[len] <= 'Z')
+            || (text[len] >= '0' && text[len] <= '9')) {
+         len++;
+     }
+     return len;
+ }
+ 
+ /**
+  * @brief Doubles the table (or creates it) and moves every variable over.
+  */
+ static void varTableGrow() {
+     unsigned oldBuckets = varBuckets;
+     struct var **old = varTable;
+ 
+     varBuckets = varBuckets ? varBuckets * 2 : VAR_BUCKETS;
+     varTable = calloc(varBuckets, sizeof *varTable);
+     for (unsigned i = 0; i < oldBuckets; i++) {
+         for (struct var *v = old[i], *next; v; v = next) {
+             next = v->next;
+             unsigned bucket = hashVar(v->name, strlen(v->name)) & (varBuckets - 1);
+             v->next = varTable[bucket];
+             varTable[bucket] = v;
+         }
+     }
+     free(old);
+ }
+ 
+ /**
+  * @brief Frees a variable's old `NAME=value` string once `environ` no longer uses it.
+  */
+ static void retirePair(struct var *v) {
+     if (!v->exported) {
+         free(v->pair); // Never in environ
+         return;
+     }
+     if (retiredCount == RETIRED_MAX) varSyncEnviron(); // Frees the held strings
+     retired[retiredCount++] = v->pair;
+ }
+ 
+ /**
+  * @brief Sets a variable from its name and value.
+  *
+  * @param export `1` to export it, `0` to keep its current export flag.
+  */
+ static void varSetPart(const char *name, size_t nameLen, const char *value, int export) {
+     struct var *v = varFind(name, nameLen);
+     if (!v) {
+         if ((unsigned)varCount + 1 > varBuckets) varTableGrow();
+         unsigned bucket = hashVar(name, nameLen) & (varBuckets - 1);
+         v = calloc(1, sizeof *v);
+         v->name = strndup(name, nameLen);
+         v->next = varTable[bucket];
+         varTable[bucket] = v;
+         varCount++;
+     }
+     if (value) {
+         if (v->pair) retirePair(v);
+         v->pair = malloc(nameLen + strlen(value) + 2);
+         sprintf(v->pair, "%s=%s", v->name, value);
+     } else if (!v->pair) {
+         v->pair = malloc(nameLen + 2);
+         sprintf(v->pair, "%s=", v->name);
+     }
+     if (export) v->exported = 1;
+     if (v->exported) environDirty = 1;
+ }
+ 
+ /**
+  * @brief Imports the environment and records the shell's pid for `$$`.
+  */
+ void varsInit() {
+     shellPid = getpid();
+     for (char **env = environ; *env; env++) {
+         const char *equals = strchr(*env, '=');
+         if (equals) varSetPart(*env, equals - *env, equals + 1, 1);
+     }
+     environDirty = 0; // environ already holds exactly these
+ }
+ 
+ /**
+  * @brief Value of a variable, or `NULL` if unset.
+  */
+ const char *varGet(const char *name) {
+     struct var *v = varFind(name, strlen(name));
+     return v ? v->pair + strlen(v->name) + 1 : NULL;
+ }
+ 
+ /**
+  * @brief Returns whether `word` has the form `NAME=value`.
+  */
+ int isAssignment(const char *word) {
+     size_t len = nameLength(word);
+     return len > 0 && word[len] == '=';
+ }
+ 
+ /**
+  * @brief Sets a variable from a `NAME=value` word.
+  *
+  * @param export `1` to export it, `0` to keep its current export flag.
+  */
+ void varAssign(const char *assignment, int export) {
+     size_t len = nameLength(assignment);
+     varSetPart(assignment, len, assignment + len + 1, export);
+ }
+ 
+ /**
+  * @brief Points `environ` at the exported variables, rebuilding it only if one changed.
+  *
+  * Called right before each launch.
+  */
+ void varSyncEnviron() {
+     if (!environDirty) return;
+     free(builtEnviron);
+     builtEnviron = malloc((varCount + 1) * sizeof *builtEnviron);
+     int n = 0;
+     for (unsigned i = 0; i < varBuckets; i++) {
+         for (struct var *v = varTable[i]; v; v = v->next) {
+             if (v->exported) builtEnviron[n++] = v->pair;
+         }
+     }
+     builtEnviron[n] = NULL;
+     environ = builtEnviron;
+     environDirty = 0;
+     while (retiredCount > 0) free(retired[--retiredCount]);
+ }
+ 
+ /**
+  * @brief Built-in `export` command: exports variables, or lists them with no arguments.
+  *
+  * @return Exit status.
+  */
+ int exportBuiltin(char **args) {
+     int status = 0;
+     if (!args[1]) {
+         for (unsigned i = 0; i < varBuckets; i++) {
+             for (struct var *v = varTable[i]; v; v = v->next) {
+                 if (v->exported) printf("export %s\n", v->pair);
+             }
+         }
+         flushOutput();
+         return 0;
+     }
+     for (int i = 1; args[i]; i++) {
+         size_t len = nameLength(args[i]);
+         if (len == 0 || (args[i][len] != '=' && args[i][len] != '\0')) {
+             fprintf(stderr, "export: `%s': not a valid identifier\n", args[i]);
+             status = 1;
+         } else {
+             varSetPart(args[i], len, args[i][len] == '=' ? args[i] + len + 1 : NULL, 1);
+         }
+     }
+     return status;
+ }
+ 
+ /**
+  * @brief Built-in `unset` command: removes variables.
+  *
+  * @return Exit status.
+  */
+ int unsetBuiltin(char **args) {
+     for (int i = 1; args[i]; i++) {
+         if (!varTable) break;
+         struct var **link = &varTable[hashVar(args[i], strlen(args[i])) & (varBuckets - 1)];
+         while (*link && strcmp((*link)->name, args[i]) != 0) link = &(*link)->next;
+         if (!*link) continue;
+ 
+         struct var *v = *link;
+         *link = v->next;
+         if (v->exported) environDirty = 1;
+         retirePair(v);
+         free(v->name);
+         free(v);
+         varCount--;
+     }
+     return 0;
+ }
+ 
+ /**
+  * @brief Expands the `$` reference at `*text` into `out`, advancing `*text` past it.
+  *
+  * @return `0`, or `-1` after printing an error for a malformed `${...}`.
+  */
+ static int expandDollar(const char **text, char **out, size_t *used, size_t *cap) {
+     const char *p = *text + 1, *value;
+     char special = 0, number[32];
+     size_t len;
+ 
+     if (*p == '$' || *p == '?' || *p == '!') {
+         special = *p++;
+     } else if (*p == '{' && p[1] && strchr("$?!", p[1]) && p[2] == '}') {
+         special = p[1];
+         p += 3;
+     } else if (*p == '{') {
+         len = nameLength(p + 1);
+         if (len == 0 || p[1 + len] != '}') {
+             const char *close = strchr(p, '}');
+             fprintf(stderr, "%.*s: bad substitution\n", close ? (int)(close - *text + 1) : (int)strlen(*text), *text);
+             return -1;
+         }
+         struct var *v = varFind(p + 1, len);
+         value = v ? v->pair + len + 1 : "";
+         p += len + 2;
+     } else if ((len = nameLength(p)) > 0) {
+         struct var *v = varFind(p, len);
+         value = v ? v->pair + len + 1 : "";
+         p += len;
+     } else {
+         value = "$"; // Not a reference: a literal `$`
+     }
+ 
+     if (special) {
+         pid_t pid = special == '$' ? shellPid : lastBackgroundPid;
+         if (special == '?') snprintf(number, sizeof number, "%d", lastExitStatus);
+         else if (pid) snprintf(number, sizeof number, "%d", pid);
+         else number[0] = '\0'; // No background job yet
+         value = number;
+     }
+ 
+     len = strlen(value);
+     if (*used + len + 1 > *cap) {
+         *cap = (*used + len + 1) * 2;
+         *out = realloc(*out, *cap);
+     }
+     memcpy(*out + *used, value, len);
+     *used += len;
+     *text = p;
+     return 0;
+ }
+ 
+ // Output of one `$(...)` in the text being expanded
+ struct substitution {
+     const char *at;              // Its `$`
+     char *output;
+     size_t len;
+     int status;                  // `$?` after it ran
+ };
+ 
+ static int splitWord = 0;       // The last expandText() result holds NUL field breaks
+ 
+ static char *pattern = NULL;    // Glob form of the word being expanded (see patternAdd())
+ static size_t patternUsed = 0, patternCap = 0;
+ 
+ /**
+  * @brief Appends expanded text to the glob form of the word.
+  *
+  * Quoted text has its pattern characters escaped with `\`, so only the
+  * unquoted ones match; `*globbed` is set if there are any.
+  *
+  * @param literal Set for text that was quoted or escaped.
+  */
+ static void patternAdd(const char *text, size_t len, int literal, int *globbed) {
+     if (patternUsed + 2 * len + 1 > patternCap) {
+         patternCap = (patternUsed + 2 * len + 1) * 2;
+         pattern = realloc(pattern, patternCap);
+     }
+     for (size_t i = 0; i < len; i++) {
+         char c = text[i];
+         int meta = c == '*' || c == '?' || c == '[';
+         if (literal && (meta || c == ']' || c == '\\')) pattern[patternUsed++] = '\\';
+         else if (meta) *globbed = 1;
+         pattern[patternUsed++] = c;
+     }
+ }
+ 
+ /**
+  * @brief Runs every `$(...)` in `len` bytes of `text`, in order.
+  *
+  * Done before expandText() uses its buffers, since the commands expand
+  * their own words. Quoting follows the same `mode` rules, so a quoted
+  * `'$(...)'` does not run.
+  *
+  * @param subs Set to the outputs, in the order the substitutions appear.
+  * @return Number of substitutions, or `-1` after printing an error.
+  */
+ static int runSubstitutions(struct arena *arena, const char *text, size_t len, int mode, struct substitution **subs) {
+     const char *end = text + len;
+     int count = 0, inSingle = 0, inDouble = 0;
+ 
+     *subs = arenaAlloc(arena, (len / 3 + 1) * sizeof **subs); // Each takes at least `$()`
+     for (const char *p = text; p < end; p++) {
+         if (inSingle) {
+             inSingle = *p != '\'';
+         } else if (mode == EXPAND_WORD && *p == '\'' && !inDouble) {
+             inSingle = 1;
+         } else if (mode == EXPAND_WORD && *p == '"') {
+             inDouble = !inDouble;
+         } else if (*p == '\\' && p + 1 < end) {
+             p++;
+         } else if (*p == '$' && p + 1 < end && p[1] == '(') {
+             const char *close = substitutionEnd(p + 2, end);
+             if (!close) {
+                 fprintf(stderr, "%.*s: missing `)'\n", (int)(end - p), p);
+                 return -1;
+             }
+             struct substitution *sub = &(*subs)[count++];
+             sub->at = p;
+             sub->output = commandOutput(arena, p + 2, close - p - 2, &sub->len);
+             sub->status = lastExitStatus;
+             p = close;
+         }
+     }
+     return count;
+ }
+ 
+ /**
+  * @brief Applies quote removal and `$` expansion to `len` bytes of `text`.
+  *
+  * The `$(...)` commands run first, but a `$?` sees the status as of its
+  * own place in the text: from before the word, or from the last
+  * substitution to its left.
+  *
+  * @param arena Arena for the result.
+  * @param mode EXPAND_* rules to apply.
+  * @param quoted Set if any part of the text was quoted (may be `NULL`).
+  * @param outLen Set to the result length (may be `NULL`).
+  * @param glob Set to the word's glob pattern if it has unquoted `*`, `?` or
+  *             `[`, else to `NULL` (`NULL` to skip). Only words given a
+  *             `glob` are split: an unquoted `$(...)` then leaves a NUL
+  *             between fields and sets `splitWord`.
+  * @return NUL-terminated result, or `NULL` after printing an error.
+  */
+ static char *expandText(struct arena *arena, const char *text, size_t len, int mode, int *quoted, size_t *outLen,
+                         char **glob) {
+     static char *out = NULL;
+     static size_t cap = 0;
+     const char *end = text + len;
+     size_t used = 0, before;
+     int inSingle = 0, inDouble = 0, globbed = 0;
+     struct substitution *subs = NULL;
+     int subCount = 0, subNext = 0, statusBefore = lastExitStatus;
+ 
+     if (mode != EXPAND_QUOTES && memmem(text, len, "$(", 2)) {
+         subCount = runSubstitutions(arena, text, len, mode, &subs);
+         if (subCount == -1) return NULL;
+     }
+     int statusAfter = lastExitStatus;
+     lastExitStatus = statusBefore; // Moved along as the substitutions are passed
+     if (quoted) *quoted = 0;
+     splitWord = 0;
+     patternUsed = 0;
+     while (text < end) {
+         char c = *text;
+         if (used + 2 > cap) {
+             cap = cap ? cap * 2 : 256;
+             out = realloc(out, cap);
+         }
+         before = used;
+ 
+         if (mode != EXPAND_HEREDOC && !inDouble && c == '\'') {
+             inSingle = !inSingle;
+             if (quoted) *quoted = 1;
+             text++;
+         } else if (inSingle) {
+             out[used++] = *text++;
+         } else if (mode != EXPAND_HEREDOC && c == '"') {
+             inDouble = !inDouble;
+             if (quoted) *quoted = 1;
+             text++;
+         } else if (c == '\\' && text + 1 < end) {
+             // Inside double quotes and here-docs, a backslash only escapes `$`, `"`, `\` and `` ` ``
+             char next = text[1];
+             int escapes = mode == EXPAND_HEREDOC ? strchr("$\\`", next) != NULL
+                         : inDouble ? strchr("$\"\\`", next) != NULL : 1;
+             if (!escapes) out[used++] = c;
+             out[used++] = next;
+             text += 2;
+             if (quoted && mode != EXPAND_HEREDOC) *quoted = 1;
+             if (glob) patternAdd(out + before, used - before, 1, &globbed);
+             continue;
+         } else if (c == '$' && subNext < subCount && subs[subNext].at == text) {
+             struct substitution *sub = &subs[subNext++];
+             lastExitStatus = sub->status;
+             int split = glob && mode == EXPAND_WORD && !inDouble;
+             if (used + sub->len + 1 > cap) {
+                 cap = (used + sub->len + 1) * 2;
+                 out = realloc(out, cap);
+             }
+             for (size_t i = 0; i < sub->len; i++) {
+                 char b = sub->output[i];
+                 if (split && (b == ' ' || b == '\t' || b == '\n')) {
+                     if (used == 0 || out[used - 1] != '\0') out[used++] = '\0'; // One break per run of blanks
+                     splitWord = 1;
+                 } else if (b != '\0') {
+                     out[used++] = b;
+                 }
+             }
+             text = substitutionEnd(text + 2, end) + 1;
+             if (glob) patternAdd(out + before, used - before, 1, &globbed); // Output is never globbed
+             continue;
+         } else if (c == '$' && mode != EXPAND_QUOTES && text + 1 < end) {
+             if (expandDollar(&text, &out, &used, &cap) == -1) {
+                 lastExitStatus = statusAfter;
+                 return NULL;
+             }
+         } else {
+             out[used++] = *text++;
+         }
+         if (glob) patternAdd(out + before, used - before, inSingle || inDouble, &globbed);
+     }
+ 
+     lastExitStatus = statusAfter;
+     if (outLen) *outLen = used;
+     if (glob) *glob = globbed && !splitWord ? arenaStrndup(arena, pattern, patternUsed) : NULL;
+     return arenaStrndup(arena, out ? out : "", used);
+ }
+ 
+ /**
+  * @brief Removes quotes and backslashes from a word without expanding `$`.
+  */
+ char *removeQuotes(struct arena *arena, char *word) {
+     if (!strpbrk(word, "'\"\\")) return word;
+     return expandText(arena, word, strlen(word), EXPAND_QUOTES, NULL, NULL, NULL);
+ }
+ 
+ /**
+  * @brief Expands one word; words without quotes, `$` or pattern characters are returned as is.
+  *
+  * @param dropped Set if the word was an unquoted expansion that came out empty.
+  * @param glob Set to its glob pattern, or `NULL` if it has none (`NULL` to
+  *             skip globbing and word splitting).
+  * @param fields Set to the non-empty fields if `$(...)` split the word,
+  *               else to `NULL`; they are cut from the result in place.
+  * @param fieldCount Set to the number of fields.
+  */
+ static char *expandWord(struct arena *arena, char *word, int *dropped, char **glob, char ***fields, int *fieldCount) {
+     int quoted;
+     size_t len;
+     *dropped = 0;
+     if (glob) *glob = NULL;
+     if (fields) *fields = NULL;
+     if (!strpbrk(word, glob ? "$'\"\\*?[" : "$'\"\\")) return word;
+     char *result = expandText(arena, word, strlen(word), EXPAND_WORD, &quoted, &len, glob);
+     if (result && fields && splitWord) {
+         *fields = arenaAlloc(arena, (len / 2 + 2) * sizeof **fields);
+         *fieldCount = 0;
+         for (char *field = result; field < result + len; field += strlen(field) + 1) {
+             if (*field) (*fields)[(*fieldCount)++] = field;
+         }
+         if (*fieldCount == 0 && !quoted) *dropped = 1;
+     } else if (result && !*result && !quoted) {
+         *dropped = 1;
+     }
+     return result;
+ }
+ 
+ /**
+  * @brief Expands a pipeline's arguments, redirection targets and here-doc text in place.
+  *
+  * @return `0`, or `-1` after printing an error.
+  */
+ int expandPipeline(struct arena *arena, struct pipeline *pipeline) {
+     int dropped;
+     for (int i = 0; i < pipeline->count; i++) {
+         struct command *stage = &pipeline->stages[i];
+ 
+         // Globbing can turn a word into many, so then the words move to a new vector;
+         // they are always read from the original one
+         char **args = stage->args, **matches, **fields;
+         int kept = 0, argCount = 0, cap = 0, fieldCount, assigning = i == 0;
+         while (args[argCount]) argCount++;
+         for (int j = 0; j < argCount; j++) {
+             // Leading `NAME=value` words are neither split nor globbed
+             assigning = assigning && isAssignment(stage->args[j]);
+             char *glob, *word = expandWord(arena, stage->args[j], &dropped, assigning ? NULL : &glob,
+                                            assigning ? NULL : &fields, &fieldCount);
+             if (!word) return -1;
+             int matchCount = 0;
+             if (!assigning && fields) {
+                 matches = fields;
+                 matchCount = fieldCount;
+             } else if (!assigning && glob) {
+                 matchCount = globExpand(arena, glob, &matches);
+             }
+             if (matchCount > 0) {
+                 if (args == stage->args) {
+                     cap = kept + matchCount + argCount - j;
+                     args = arenaAlloc(arena, (cap + 1) * sizeof *args);
+                     memcpy(args, stage->args, kept * sizeof *args);
+                 } else if (kept + matchCount + argCount - j > cap) {
+                     char **grown = arenaAlloc(arena, (2 * cap + matchCount + 1) * sizeof *args);
+                     memcpy(grown, args, kept * sizeof *args);
+                     cap = 2 * cap + matchCount;
+                     args = grown;
+                 }
+                 memcpy(&args[kept], matches, matchCount * sizeof *args);
+                 kept += matchCount;
+             } else if (!dropped) { // A stage left with no words runs nothing (see runPipeline())
+                 args[kept++] = word;
+             }
+         }
+         args[kept] = NULL;
+         stage->args = args;
+ 
+         char **targets[] = { &stage->inputFile, &stage->outputFile, &stage->errorFile };
+         for (int j = 0; j < 3; j++) {
+             if (*targets[j] && !(*targets[j] = expandWord(arena, *targets[j], &dropped, NULL, NULL, NULL))) return -1;
+         }
+ 
+         if (stage->inputExpand == INPUT_WORD) { // Here-string: the word, then a newline
+             char *text = expandText(arena, stage->inputText, stage->inputLen - 1, EXPAND_WORD, NULL,
+                                     &stage->inputLen, NULL);
+             if (!text) return -1;
+             stage->inputText = arenaAlloc(arena, ++stage->inputLen);
+             memcpy(stage->inputText, text, stage->inputLen - 1);
+             stage->inputText[stage->inputLen - 1] = '\n';
+         } else if (stage->inputExpand == INPUT_HEREDOC && stage->inputText) {
+             stage->inputText = expandText(arena, stage->inputText, stage->inputLen, EXPAND_HEREDOC, NULL,
+                                           &stage->inputLen, NULL);
+             if (!stage->inputText) return -1;
+         }
+     }
+     return 0;
+ }